@@ -0,0 +1,107 @@
+/*
+ * ADC Block Filters - Reduce One DMA Block of Samples to One Reading
+ *
+ * Shared by all three firmware variants. Pure logic on raw 12-bit
+ * samples, so the same code runs in the host simulation.
+ *
+ * - Moving average: mean of the block (white noise drops by sqrt(n))
+ * - Median: middle sample of the block, ignores spikes and dropouts
+ * - EMA: exponential average run over every sample, carried across
+ *   blocks, alpha = 1 / 2^shift
+ *
+ * A filter is picked at compile time with one of the initializers below,
+ * e.g. `static adc_filter_t f = ADC_FILTER_EMA(4);`.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct adc_filter adc_filter_t;
+
+// Returns the filtered reading for block[0..n-1] (n > 0). The block may
+// be reordered.
+typedef int (*adc_filter_fn_t)(adc_filter_t *f, uint16_t *block, size_t n);
+
+struct adc_filter {
+    const char *name;
+    adc_filter_fn_t run;
+    uint8_t shift;          // EMA: alpha = 1 / 2^shift
+    bool primed;            // EMA: state holds a value
+    uint32_t state;         // EMA: average in Q8
+};
+
+static inline int adc_filter_moving_avg(adc_filter_t *f, uint16_t *block, size_t n)
+{
+    (void)f;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += block[i];
+    }
+    return (int)((sum + n / 2) / n);
+}
+
+// Wirth's selection: partial partitioning in place, O(n) on average
+static inline int adc_filter_median(adc_filter_t *f, uint16_t *block, size_t n)
+{
+    (void)f;
+    int k = (int)(n / 2);
+    int lo = 0;
+    int hi = (int)n - 1;
+    while (lo < hi) {
+        uint16_t pivot = block[k];
+        int i = lo;
+        int j = hi;
+        do {
+            while (block[i] < pivot) {
+                i++;
+            }
+            while (pivot < block[j]) {
+                j--;
+            }
+            if (i <= j) {
+                uint16_t t = block[i];
+                block[i] = block[j];
+                block[j] = t;
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k) {
+            lo = i;
+        }
+        if (k < i) {
+            hi = j;
+        }
+    }
+    return block[k];
+}
+
+static inline int adc_filter_ema(adc_filter_t *f, uint16_t *block, size_t n)
+{
+    size_t i = 0;
+    if (!f->primed) {
+        f->state = (uint32_t)block[0] << 8;
+        f->primed = true;
+        i = 1;
+    }
+    int32_t y = (int32_t)f->state;
+    for (; i < n; i++) {
+        y += (((int32_t)block[i] << 8) - y) >> f->shift;
+    }
+    f->state = (uint32_t)y;
+    return (int)((f->state + 128) >> 8);
+}
+
+#define ADC_FILTER_MOVING_AVG() \
+    { .name = "moving average", .run = adc_filter_moving_avg }
+#define ADC_FILTER_MEDIAN() \
+    { .name = "median", .run = adc_filter_median }
+#define ADC_FILTER_EMA(shift_) \
+    { .name = "EMA", .run = adc_filter_ema, .shift = (shift_) }
+
+static inline int adc_filter_run(adc_filter_t *f, uint16_t *block, size_t n)
+{
+    return f->run(f, block, n);
+}
@@ -0,0 +1,102 @@
+/*
+ * Auto Mode Switching - Hysteresis / Debounce State Machine
+ *
+ * Shared by all three firmware variants. Pure logic: time is passed in
+ * (esp_timer microseconds), so the same code runs in the host simulation.
+ *
+ * - Dark/bright uses two thresholds, so a reading hovering at the
+ *   threshold can't flip the decision back and forth
+ * - Motion is held for motion_hold_ms after the PIR clears
+ * - The output keeps each state for at least min_on_ms / min_off_ms
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AUTO_LIGHT_NO_RECHECK   INT64_MAX
+
+typedef struct {
+    int dark_threshold;         // Reading that enters "dark"
+    int bright_threshold;       // Reading that leaves "dark" again
+    bool dark_is_high;          // true: higher reading = darker (LDR to GND)
+    uint32_t motion_hold_ms;    // Keep "occupied" this long after motion clears
+    uint32_t min_on_ms;         // Minimum time the light stays on
+    uint32_t min_off_ms;        // Minimum time the light stays off
+} auto_light_config_t;
+
+typedef struct {
+    auto_light_config_t cfg;
+    bool dark;
+    bool motion;
+    int64_t motion_clear_us;    // When motion last cleared
+    bool output;                // Last output state (auto or manual)
+    int64_t output_since_us;    // When the output last switched
+} auto_light_t;
+
+// Dark/bright classification with hysteresis around the two thresholds
+static inline bool auto_light_classify(const auto_light_config_t *cfg, bool was_dark, int value)
+{
+    int threshold = was_dark ? cfg->bright_threshold : cfg->dark_threshold;
+    return cfg->dark_is_high ? (value > threshold) : (value < threshold);
+}
+
+static inline void auto_light_init(auto_light_t *al, const auto_light_config_t *cfg,
+                                   int light_value, bool motion, bool output, int64_t now_us)
+{
+    al->cfg = *cfg;
+    al->dark = auto_light_classify(cfg, false, light_value);
+    al->motion = motion;
+    al->motion_clear_us = motion ? 0 : now_us - (int64_t)cfg->motion_hold_ms * 1000;
+    al->output = output;
+    // Dwell only restricts switches made after boot
+    al->output_since_us = now_us - (int64_t)(cfg->min_on_ms > cfg->min_off_ms ?
+                                             cfg->min_on_ms : cfg->min_off_ms) * 1000;
+}
+
+static inline void auto_light_set_light(auto_light_t *al, int value)
+{
+    al->dark = auto_light_classify(&al->cfg, al->dark, value);
+}
+
+static inline void auto_light_set_motion(auto_light_t *al, bool motion, int64_t now_us)
+{
+    if (al->motion && !motion) {
+        al->motion_clear_us = now_us;
+    }
+    al->motion = motion;
+}
+
+// Record an output switch (auto or manual) so dwell times apply to it
+static inline void auto_light_note_switch(auto_light_t *al, bool on, int64_t now_us)
+{
+    if (on != al->output) {
+        al->output = on;
+        al->output_since_us = now_us;
+    }
+}
+
+// Decide the output at now_us. *recheck_us is set to the time at which
+// the decision may change without any new input (hold-off or dwell
+// expiry), or AUTO_LIGHT_NO_RECHECK.
+static inline bool auto_light_decide(const auto_light_t *al, int64_t now_us, int64_t *recheck_us)
+{
+    *recheck_us = AUTO_LIGHT_NO_RECHECK;
+
+    int64_t hold_until = al->motion_clear_us + (int64_t)al->cfg.motion_hold_ms * 1000;
+    bool occupied = al->motion || now_us < hold_until;
+    bool want = al->dark && occupied;
+
+    if (want != al->output) {
+        uint32_t dwell_ms = al->output ? al->cfg.min_on_ms : al->cfg.min_off_ms;
+        int64_t dwell_until = al->output_since_us + (int64_t)dwell_ms * 1000;
+        if (now_us < dwell_until) {
+            *recheck_us = dwell_until;
+            return al->output;
+        }
+    }
+    if (want && !al->motion) {
+        *recheck_us = hold_until;
+    }
+    return want;
+}
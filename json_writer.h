@@ -0,0 +1,153 @@
+/*
+ * JSON Writer - Compact Output into a Caller-Supplied Buffer
+ *
+ * Shared by all three firmware variants for the /status payload. No heap:
+ * the caller owns the buffer (usually on the stack), values are appended
+ * in place, and overflow is sticky, so a handler checks once at the end.
+ *
+ *   char buf[256];
+ *   json_writer_t w;
+ *   json_writer_init(&w, buf, sizeof(buf));
+ *   json_obj_begin(&w, NULL);
+ *   json_add_bool(&w, "lightOn", true);
+ *   json_obj_end(&w);
+ *   if (json_writer_ok(&w)) send(buf, w.len);
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;             // Bytes written, excluding the terminating NUL
+    bool overflow;
+    bool need_comma;
+} json_writer_t;
+
+static inline void json_writer_init(json_writer_t *w, char *buf, size_t cap)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = (cap == 0);
+    w->need_comma = false;
+    if (cap > 0) {
+        buf[0] = '\0';
+    }
+}
+
+static inline bool json_writer_ok(const json_writer_t *w)
+{
+    return !w->overflow;
+}
+
+static inline void json_put(json_writer_t *w, const char *s, size_t n)
+{
+    if (w->overflow || n >= w->cap - w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+static inline void json_put_char(json_writer_t *w, char c)
+{
+    json_put(w, &c, 1);
+}
+
+static inline void json_put_string(json_writer_t *w, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    json_put_char(w, '"');
+    for (const char *p = s; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            json_put(w, esc, 2);
+        } else if (c < 0x20) {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            json_put(w, esc, 6);
+        } else {
+            json_put_char(w, (char)c);
+        }
+    }
+    json_put_char(w, '"');
+}
+
+// Separator and "key": for the next member (key is NULL inside arrays)
+static inline void json_put_key(json_writer_t *w, const char *key)
+{
+    if (w->need_comma) {
+        json_put_char(w, ',');
+    }
+    w->need_comma = true;
+    if (key != NULL) {
+        json_put_string(w, key);
+        json_put_char(w, ':');
+    }
+}
+
+static inline void json_obj_begin(json_writer_t *w, const char *key)
+{
+    json_put_key(w, key);
+    json_put_char(w, '{');
+    w->need_comma = false;
+}
+
+static inline void json_obj_end(json_writer_t *w)
+{
+    json_put_char(w, '}');
+    w->need_comma = true;
+}
+
+static inline void json_arr_begin(json_writer_t *w, const char *key)
+{
+    json_put_key(w, key);
+    json_put_char(w, '[');
+    w->need_comma = false;
+}
+
+static inline void json_arr_end(json_writer_t *w)
+{
+    json_put_char(w, ']');
+    w->need_comma = true;
+}
+
+// 32-bit on purpose: 64-bit division is a library call on the ESP32
+static inline void json_add_int(json_writer_t *w, const char *key, int32_t v)
+{
+    char digits[12];
+    size_t i = sizeof(digits);
+    uint32_t u = (v < 0) ? 0 - (uint32_t)v : (uint32_t)v;
+    do {
+        digits[--i] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (v < 0) {
+        digits[--i] = '-';
+    }
+    json_put_key(w, key);
+    json_put(w, digits + i, sizeof(digits) - i);
+}
+
+static inline void json_add_bool(json_writer_t *w, const char *key, bool v)
+{
+    json_put_key(w, key);
+    if (v) {
+        json_put(w, "true", 4);
+    } else {
+        json_put(w, "false", 5);
+    }
+}
+
+static inline void json_add_str(json_writer_t *w, const char *key, const char *v)
+{
+    json_put_key(w, key);
+    json_put_string(w, v);
+}
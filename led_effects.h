@@ -0,0 +1,569 @@
+/*
+ * LED Effects - Fixed-Point Effect Kernels for the WS2812 Renderer
+ *
+ * Shared by smartlightws2812.c and the host benchmark. Every kernel
+ * draws one frame of n pixels with integer math only: the sine comes
+ * from a 256-entry table (one period), brightness is applied by
+ * multiply-and-shift (scale8) instead of a division per channel, and
+ * per-pixel hue steps are accumulated in 8.8 fixed point.
+ *
+ * Frames are arrays of grb_t: 3 bytes per pixel in the order the WS2812
+ * takes them off the wire, so a frame is exactly as large as the data it
+ * sends (6 KB for 2000 pixels).
+ *
+ * Effects are described in led_effect_table, indexed by the /control
+ * effect number: a draw function, the frame rate it needs (0 for a
+ * static picture), its default speed and which settings it reads. The
+ * renderer dispatches through the table and runs its frame clock at the
+ * fastest rate any visible effect declares.
+ *
+ * Segments: a strip can be split into named pixel ranges, each with its
+ * own effect, colour, brightness and speed. led_compose() draws the
+ * whole strip with the base settings, then every segment over its range
+ * in order, so later segments win where ranges overlap. Ranges past the
+ * end of the strip are clipped.
+ *
+ * Transitions: colour and brightness move to a new target over a given
+ * time instead of jumping. A led_transition_t is evaluated once per
+ * frame (a few multiplies, whatever the strip length); a new target
+ * starts from wherever the old fade has got to, so a burst of commands
+ * becomes one moving target rather than a burst of jumps.
+ *
+ * Power: led_power_ma() estimates the supply current of a frame from
+ * the PWM values it puts on the wire, and led_power_scale() gives the
+ * factor that brings it down to a budget. The model is linear: each
+ * channel draws up to LED_MA_PER_CHANNEL at full PWM, and every pixel
+ * LED_MA_IDLE for its driver whatever it shows.
+ *
+ * Brightness is 0..255 here; the firmware converts its percentage once
+ * per frame with led_percent_to_scale().
+ *
+ * led_gamma8 maps a linear channel value to the PWM value the eye sees
+ * as that fraction of full brightness (gamma 2.2). Any non-zero input
+ * stays at least 1, so a dim colour is not turned off. led_gamma16 holds
+ * the same curve with 8 fractional bits; led_dither8() turns it into a
+ * PWM value whose average over LED_DITHER_PHASES frames carries 2 of
+ * those bits, so the lowest steps of a dim light (1 to 2 is twice as
+ * bright) come in quarters. Dithering is applied only below
+ * LED_DITHER_MAX, where one step is visible.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Light Effect Definitions (values are the /control effect numbers)
+typedef enum {
+    EFFECT_NONE = 0,
+    EFFECT_FADE,
+    EFFECT_BREATH,
+    EFFECT_RAINBOW,
+    EFFECT_RAINBOW_CYCLE,
+    EFFECT_COUNT
+} light_effect_t;
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} rgb_t;
+
+typedef struct {
+    uint8_t g;
+    uint8_t r;
+    uint8_t b;
+} grb_t;
+
+static inline grb_t grb_from_rgb(rgb_t c)
+{
+    return (grb_t){ c.g, c.r, c.b };
+}
+
+// One breath (EFFECT_BREATH) every 2 pi seconds
+#define LED_BREATH_PERIOD_MS    6283
+
+// round(127.5 + 127.5 * sin(2 pi i / 256))
+static const uint8_t led_sin8_lut[256] = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+    176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+    176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+     79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+     37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+     10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+      0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+     10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+     37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+     79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+};
+
+// round(255 * (i / 255) ^ 2.2), at least 1 for i > 0
+static const uint8_t led_gamma8[256] = {
+      0,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+// The same curve in 8.8 fixed point for temporal dithering:
+// round(65280 * (i / 255) ^ 2.2), at least 256 (1.0) for i > 0
+static const uint16_t led_gamma16[256] = {
+        0,   256,   256,   256,   256,   256,   256,   256,
+      256,   256,   256,   256,   256,   256,   256,   256,
+      256,   256,   256,   256,   256,   269,   298,   328,
+      360,   394,   430,   467,   506,   547,   589,   633,
+      679,   726,   776,   827,   880,   934,   991,  1049,
+     1109,  1171,  1235,  1300,  1368,  1437,  1508,  1581,
+     1656,  1733,  1812,  1893,  1975,  2060,  2146,  2235,
+     2325,  2417,  2512,  2608,  2706,  2806,  2908,  3013,
+     3119,  3227,  3337,  3450,  3564,  3680,  3798,  3919,
+     4041,  4166,  4292,  4421,  4552,  4685,  4819,  4956,
+     5096,  5237,  5380,  5525,  5673,  5823,  5974,  6128,
+     6284,  6442,  6603,  6765,  6930,  7097,  7266,  7437,
+     7610,  7786,  7963,  8143,  8325,  8509,  8696,  8885,
+     9075,  9268,  9464,  9661,  9861, 10063, 10267, 10474,
+    10682, 10893, 11107, 11322, 11540, 11760, 11982, 12207,
+    12433, 12663, 12894, 13128, 13363, 13602, 13842, 14085,
+    14330, 14578, 14827, 15080, 15334, 15591, 15850, 16111,
+    16375, 16641, 16909, 17180, 17453, 17729, 18006, 18287,
+    18569, 18854, 19141, 19431, 19723, 20017, 20314, 20613,
+    20915, 21218, 21525, 21833, 22144, 22458, 22774, 23092,
+    23413, 23736, 24062, 24390, 24720, 25053, 25388, 25726,
+    26066, 26408, 26753, 27101, 27451, 27803, 28158, 28515,
+    28875, 29237, 29602, 29969, 30338, 30710, 31085, 31462,
+    31841, 32223, 32608, 32995, 33384, 33776, 34170, 34567,
+    34967, 35369, 35773, 36180, 36589, 37001, 37416, 37833,
+    38252, 38674, 39099, 39526, 39956, 40388, 40823, 41260,
+    41700, 42142, 42587, 43034, 43484, 43937, 44392, 44849,
+    45310, 45772, 46238, 46706, 47176, 47649, 48125, 48603,
+    49084, 49567, 50053, 50542, 51033, 51526, 52023, 52522,
+    53023, 53527, 54034, 54543, 55055, 55570, 56087, 56607,
+    57129, 57654, 58182, 58712, 59245, 59780, 60318, 60859,
+    61402, 61948, 62497, 63048, 63602, 64159, 64718, 65280,
+};
+
+// v * s / 255, exact at both ends (s = 0 gives 0, s = 255 gives v)
+static inline uint8_t scale8(uint8_t v, uint8_t s)
+{
+    return (uint8_t)(((uint16_t)v * (uint16_t)(s + 1)) >> 8);
+}
+
+static inline rgb_t rgb_scale8(rgb_t c, uint8_t s)
+{
+    return (rgb_t){ scale8(c.r, s), scale8(c.g, s), scale8(c.b, s) };
+}
+
+static inline uint8_t led_percent_to_scale(uint8_t percent)
+{
+    return (percent >= 100) ? 255 : (uint8_t)((percent * 255 + 50) / 100);
+}
+
+// Hue 0..255 around the colour wheel at full saturation and value
+static inline rgb_t led_hue8(uint8_t hue)
+{
+    uint8_t region = hue / 43;
+    uint8_t rise = (uint8_t)((hue - region * 43) * 6);
+    uint8_t fall = 255 - rise;
+    switch (region) {
+        case 0: return (rgb_t){ 255, rise, 0 };
+        case 1: return (rgb_t){ fall, 255, 0 };
+        case 2: return (rgb_t){ 0, 255, rise };
+        case 3: return (rgb_t){ 0, fall, 255 };
+        case 4: return (rgb_t){ rise, 0, 255 };
+        default: return (rgb_t){ 255, 0, fall };
+    }
+}
+
+static inline void led_fx_fill(grb_t *frame, uint32_t n, rgb_t c)
+{
+    grb_t px = grb_from_rgb(c);
+    for (uint32_t i = 0; i < n; i++) {
+        frame[i] = px;
+    }
+}
+
+static inline void led_fx_solid(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale)
+{
+    led_fx_fill(frame, n, rgb_scale8(color, scale));
+}
+
+static inline void led_fx_breath(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale, uint32_t t_ms)
+{
+    uint8_t phase = (uint8_t)((t_ms % LED_BREATH_PERIOD_MS) * 256 / LED_BREATH_PERIOD_MS);
+    led_fx_fill(frame, n, rgb_scale8(color, scale8(scale, led_sin8_lut[phase])));
+}
+
+static inline void led_fx_rainbow(grb_t *frame, uint32_t n, uint8_t hue, uint8_t scale)
+{
+    led_fx_fill(frame, n, rgb_scale8(led_hue8(hue), scale));
+}
+
+// Hues hue0, hue0 + step, ... (step in 1/256 hue units) over a span of
+// pixels. The colour is only converted when the hue changes, so on a
+// strip longer than the wheel has hues each one is converted once and
+// the runs between are plain copies.
+static inline void led_hue_span(grb_t *frame, uint32_t n, uint32_t hue0_8_8, uint32_t step_8_8,
+                                uint8_t scale)
+{
+    uint32_t acc = hue0_8_8;
+    int last = -1;
+    grb_t px = { 0, 0, 0 };
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t hue = (uint8_t)(acc >> 8);
+        if (hue != last) {
+            px = grb_from_rgb(rgb_scale8(led_hue8(hue), scale));
+            last = hue;
+        }
+        frame[i] = px;
+        acc += step_8_8;
+    }
+}
+
+// The whole colour wheel spread along the strip, starting at hue
+static inline void led_fx_rainbow_cycle(grb_t *frame, uint32_t n, uint8_t hue, uint8_t scale)
+{
+    if (n == 0) {
+        return;
+    }
+    led_hue_span(frame, n, (uint32_t)hue << 8, (256u << 8) / n, scale);
+}
+
+// ==================== Effect Registry ====================
+
+// Settings an effect reads from its segment (or the base settings)
+#define LED_FX_USES_COLOR   0x01
+#define LED_FX_USES_SPEED   0x02
+#define LED_FX_HUE_STEPS    0x04    // Needs a frame per led_fx_hue() step
+
+// One frame of an effect over n pixels. scale is 0..255, speed 0..99,
+// t_ms the time the effect has run.
+typedef void (*led_fx_draw_fn)(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale,
+                               uint8_t speed, uint32_t t_ms);
+
+typedef struct {
+    const char *name;
+    led_fx_draw_fn draw;
+    uint8_t fps;            // Frames per second it needs (at least); 0: static
+    uint8_t default_speed;
+    uint8_t uses;           // LED_FX_USES_*
+} led_effect_desc_t;
+
+// Rainbows step the hue once every 100 - speed ms
+static inline uint8_t led_fx_hue(uint8_t speed, uint32_t t_ms)
+{
+    uint32_t hue_ms = (speed < 100) ? 100 - speed : 1;
+    return (uint8_t)(t_ms / hue_ms);
+}
+
+static inline void led_draw_solid(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale,
+                                  uint8_t speed, uint32_t t_ms)
+{
+    (void)speed;
+    (void)t_ms;
+    led_fx_solid(frame, n, color, scale);
+}
+
+static inline void led_draw_breath(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale,
+                                   uint8_t speed, uint32_t t_ms)
+{
+    (void)speed;
+    led_fx_breath(frame, n, color, scale, t_ms);
+}
+
+static inline void led_draw_rainbow(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale,
+                                    uint8_t speed, uint32_t t_ms)
+{
+    (void)color;
+    led_fx_rainbow(frame, n, led_fx_hue(speed, t_ms), scale);
+}
+
+static inline void led_draw_rainbow_cycle(grb_t *frame, uint32_t n, rgb_t color, uint8_t scale,
+                                          uint8_t speed, uint32_t t_ms)
+{
+    (void)color;
+    led_fx_rainbow_cycle(frame, n, led_fx_hue(speed, t_ms), scale);
+}
+
+// Indexed by light_effect_t. To add an effect, give it the next enum
+// value, a draw function and a row here; the renderer, /control
+// validation and GET /effects pick it up from the table.
+static const led_effect_desc_t led_effect_table[] = {
+    [EFFECT_NONE]          = { "solid",         led_draw_solid,          0, 50, LED_FX_USES_COLOR },
+    [EFFECT_FADE]          = { "fade",          led_draw_solid,          0, 50, LED_FX_USES_COLOR },
+    [EFFECT_BREATH]        = { "breath",        led_draw_breath,        50, 50, LED_FX_USES_COLOR },
+    [EFFECT_RAINBOW]       = { "rainbow",       led_draw_rainbow,       25, 50, LED_FX_USES_SPEED | LED_FX_HUE_STEPS },
+    [EFFECT_RAINBOW_CYCLE] = { "rainbow_cycle", led_draw_rainbow_cycle, 50, 50, LED_FX_USES_SPEED | LED_FX_HUE_STEPS },
+};
+
+#define LED_EFFECT_COUNT    ((int)(sizeof(led_effect_table) / sizeof(led_effect_table[0])))
+_Static_assert(LED_EFFECT_COUNT == EFFECT_COUNT, "every light_effect_t needs a led_effect_table row");
+
+// Descriptor of an effect number, or NULL if there is no such effect
+static inline const led_effect_desc_t *led_effect_get(int effect)
+{
+    if (effect < 0 || effect >= LED_EFFECT_COUNT || led_effect_table[effect].draw == NULL) {
+        return NULL;
+    }
+    return &led_effect_table[effect];
+}
+
+// Frame rate an effect needs at speed: its own, or more for a rainbow
+// whose hue steps come faster, so that no step is skipped (the renderer
+// still caps it at its frame rate)
+static inline uint8_t led_effect_fps(int effect, uint8_t speed)
+{
+    const led_effect_desc_t *fx = led_effect_get(effect);
+    if (fx == NULL) {
+        return 0;
+    }
+    uint32_t fps = fx->fps;
+    if (fx->uses & LED_FX_HUE_STEPS) {
+        uint32_t hue_ms = (speed < 100) ? 100 - speed : 1;
+        uint32_t step_fps = (1000 + hue_ms - 1) / hue_ms;
+        if (step_fps > fps) {
+            fps = (step_fps < 255) ? step_fps : 255;
+        }
+    }
+    return (uint8_t)fps;
+}
+
+// One effect over n pixels; an unknown effect draws solid
+static inline void led_fx_draw(grb_t *frame, uint32_t n, int effect, rgb_t color,
+                               uint8_t scale, uint8_t speed, uint32_t t_ms)
+{
+    const led_effect_desc_t *fx = led_effect_get(effect);
+    if (fx == NULL) {
+        fx = &led_effect_table[EFFECT_NONE];
+    }
+    fx->draw(frame, n, color, scale, speed, t_ms);
+}
+
+// ==================== Segments ====================
+
+#define LED_SEGMENT_MAX         8
+#define LED_SEGMENT_NAME_MAX    16      // Including the terminator
+
+typedef struct {
+    char name[LED_SEGMENT_NAME_MAX];
+    uint16_t start;
+    uint16_t len;
+    uint8_t effect;                     // light_effect_t
+    uint8_t brightness;                 // Percent
+    uint8_t speed;
+    rgb_t color;
+} led_segment_t;
+
+typedef struct {
+    uint8_t count;
+    led_segment_t seg[LED_SEGMENT_MAX];
+} led_segments_t;
+
+static inline int led_segment_find(const led_segments_t *set, const char *name)
+{
+    for (int i = 0; i < set->count; i++) {
+        if (strncmp(set->seg[i].name, name, LED_SEGMENT_NAME_MAX) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Add seg, or replace the segment of the same name. False if the set is full.
+static inline bool led_segment_put(led_segments_t *set, const led_segment_t *seg)
+{
+    int i = led_segment_find(set, seg->name);
+    if (i < 0) {
+        if (set->count == LED_SEGMENT_MAX) {
+            return false;
+        }
+        i = set->count++;
+    }
+    set->seg[i] = *seg;
+    return true;
+}
+
+static inline bool led_segment_remove(led_segments_t *set, const char *name)
+{
+    int i = led_segment_find(set, name);
+    if (i < 0) {
+        return false;
+    }
+    memmove(&set->seg[i], &set->seg[i + 1], (set->count - i - 1) * sizeof(set->seg[0]));
+    set->count--;
+    return true;
+}
+
+// Whether any of the base shows (the first segment does not cover it)
+static inline bool led_compose_base_visible(uint32_t n, const led_segments_t *set)
+{
+    return set->count == 0 || set->seg[0].start > 0 || set->seg[0].len < n;
+}
+
+// Frame rate a composition needs: that of its fastest visible effect
+static inline uint8_t led_compose_fps(uint32_t n, const led_segment_t *base, const led_segments_t *set)
+{
+    uint8_t fps = led_compose_base_visible(n, set) ? led_effect_fps(base->effect, base->speed) : 0;
+    for (int i = 0; i < set->count; i++) {
+        const led_segment_t *seg = &set->seg[i];
+        uint8_t seg_fps = led_effect_fps(seg->effect, seg->speed);
+        if (seg->start < n && seg->len > 0 && seg_fps > fps) {
+            fps = seg_fps;
+        }
+    }
+    return fps;
+}
+
+// Base effect over the whole strip, then each segment over its range.
+// master scales every segment's own brightness (both 0..255).
+static inline void led_compose(grb_t *frame, uint32_t n, const led_segment_t *base,
+                               const led_segments_t *set, uint8_t master, uint32_t t_ms)
+{
+    if (led_compose_base_visible(n, set)) {
+        led_fx_draw(frame, n, base->effect, base->color,
+                    scale8(master, led_percent_to_scale(base->brightness)), base->speed, t_ms);
+    }
+    for (int i = 0; i < set->count; i++) {
+        const led_segment_t *seg = &set->seg[i];
+        if (seg->start >= n || seg->len == 0) {
+            continue;
+        }
+        uint32_t len = (seg->len < n - seg->start) ? seg->len : n - seg->start;
+        led_fx_draw(frame + seg->start, len, seg->effect, seg->color,
+                    scale8(master, led_percent_to_scale(seg->brightness)), seg->speed, t_ms);
+    }
+}
+
+// ==================== Transitions ====================
+
+// What a fade interpolates: the base colour and the master level
+// (0 is off)
+typedef struct {
+    rgb_t color;
+    uint8_t level;
+} led_look_t;
+
+typedef struct {
+    led_look_t from;
+    led_look_t to;
+    uint32_t start_ms;
+    uint32_t dur_ms;        // 0: the target is shown at once
+} led_transition_t;
+
+// a + (b - a) * frac / 256, frac 0..256
+static inline uint8_t led_lerp8(uint8_t a, uint8_t b, uint16_t frac)
+{
+    return (uint8_t)(a + (((int32_t)b - a) * frac >> 8));
+}
+
+static inline bool led_look_equal(led_look_t a, led_look_t b)
+{
+    return a.level == b.level && a.color.r == b.color.r && a.color.g == b.color.g &&
+           a.color.b == b.color.b;
+}
+
+static inline bool led_transition_active(const led_transition_t *t, uint32_t now_ms)
+{
+    return now_ms - t->start_ms < t->dur_ms;
+}
+
+static inline led_look_t led_transition_at(const led_transition_t *t, uint32_t now_ms)
+{
+    if (!led_transition_active(t, now_ms)) {
+        return t->to;
+    }
+    uint16_t frac = (uint16_t)(((now_ms - t->start_ms) << 8) / t->dur_ms);
+    return (led_look_t){
+        .color = {
+            led_lerp8(t->from.color.r, t->to.color.r, frac),
+            led_lerp8(t->from.color.g, t->to.color.g, frac),
+            led_lerp8(t->from.color.b, t->to.color.b, frac),
+        },
+        .level = led_lerp8(t->from.level, t->to.level, frac),
+    };
+}
+
+// Head for a new target from what is shown at now_ms
+static inline void led_transition_to(led_transition_t *t, led_look_t to, uint32_t now_ms,
+                                     uint32_t dur_ms)
+{
+    t->from = led_transition_at(t, now_ms);
+    t->to = to;
+    t->start_ms = now_ms;
+    t->dur_ms = dur_ms;
+}
+
+// ==================== Dithering ====================
+
+#define LED_DITHER_PHASES   4
+#define LED_DITHER_MAX      32      // PWM values from here up are rounded
+
+// Ordered thresholds, one per phase; the phase is offset by the pixel
+// index so neighbours do not blink together
+static const uint8_t led_dither_thresh[LED_DITHER_PHASES] = { 32, 160, 96, 224 };
+
+// PWM value for channel value v in the given phase. *fraction is set if
+// the output depends on the phase.
+static inline uint8_t led_dither8(uint8_t v, uint8_t phase, bool *fraction)
+{
+    uint16_t v16 = led_gamma16[v];
+    if (v16 >= (LED_DITHER_MAX << 8)) {
+        return (uint8_t)((v16 + 128) >> 8);
+    }
+    if (v16 & 0xFF) {
+        *fraction = true;
+    }
+    return (uint8_t)((v16 + led_dither_thresh[phase % LED_DITHER_PHASES]) >> 8);
+}
+
+// ==================== Power ====================
+
+#define LED_MA_PER_CHANNEL  20      // At PWM 255
+#define LED_MA_IDLE         1       // Per pixel, even when dark
+
+// Sum of the PWM values a frame puts on the wire (through led_gamma8)
+static inline uint32_t led_frame_pwm_sum(const grb_t *frame, uint32_t n)
+{
+    const uint8_t *src = (const uint8_t *)frame;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n * 3; i++) {
+        sum += led_gamma8[src[i]];
+    }
+    return sum;
+}
+
+static inline uint32_t led_power_ma(uint32_t pwm_sum, uint32_t n)
+{
+    return (pwm_sum * LED_MA_PER_CHANNEL + 127) / 255 + n * LED_MA_IDLE;
+}
+
+// PWM scale (255: none) that keeps a frame drawing ma within budget_ma.
+// Only the channel current scales; the idle current stays.
+static inline uint8_t led_power_scale(uint32_t ma, uint32_t n, uint32_t budget_ma)
+{
+    uint32_t idle = n * LED_MA_IDLE;
+    if (ma <= budget_ma) {
+        return 255;
+    }
+    if (budget_ma <= idle) {
+        return 0;
+    }
+    return (uint8_t)((budget_ma - idle) * 255 / (ma - idle));
+}
@@ -0,0 +1,94 @@
+/*
+ * Light Sensor Calibration - Raw ADC to Millivolts, Lux and Percent
+ *
+ * Shared by all three firmware variants. The table is built once at boot
+ * from the ADC calibration scheme (raw -> mV) and the LDR divider model
+ * (mV -> lux); every reading after that is two table lookups and an
+ * integer interpolation, so the sampler, /status and telemetry all report
+ * the same numbers without float math per sample.
+ *
+ * LDR model: R = r10_ohms * (10 lux / E)^gamma, i.e.
+ *   E = 10 * (r10_ohms / R)^(1 / gamma)
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#define LIGHT_CAL_RAW_MAX       4095
+#define LIGHT_CAL_SHIFT         4       // One table entry per 16 raw counts
+#define LIGHT_CAL_POINTS        ((LIGHT_CAL_RAW_MAX >> LIGHT_CAL_SHIFT) + 2)
+#define LIGHT_CAL_LUX_MAX       UINT16_MAX
+
+typedef struct {
+    int vcc_mv;                 // Divider supply
+    int fixed_ohms;             // Fixed divider resistor
+    int ldr_r10_ohms;           // LDR resistance at 10 lux
+    float ldr_gamma;            // LDR slope (log R / log lux)
+    bool ldr_to_gnd;            // true: LDR is the low side (dark = high reading)
+} light_cal_config_t;
+
+typedef struct {
+    uint16_t mv[LIGHT_CAL_POINTS];
+    uint16_t lux[LIGHT_CAL_POINTS];
+    uint8_t percent[LIGHT_CAL_POINTS];  // 0 = darkest, 100 = brightest
+} light_cal_t;
+
+typedef struct {
+    int raw;
+    int mv;
+    int lux;
+    int percent;
+} light_reading_t;
+
+// raw -> mV from the ADC calibration scheme; ctx is passed through
+typedef int (*light_cal_mv_fn_t)(int raw, void *ctx);
+
+static inline int light_cal_lux_of_mv(const light_cal_config_t *cfg, int mv)
+{
+    if (mv <= 0) {
+        return cfg->ldr_to_gnd ? LIGHT_CAL_LUX_MAX : 0;
+    }
+    if (mv >= cfg->vcc_mv) {
+        return cfg->ldr_to_gnd ? 0 : LIGHT_CAL_LUX_MAX;
+    }
+    double r = cfg->ldr_to_gnd ?
+               (double)cfg->fixed_ohms * mv / (cfg->vcc_mv - mv) :
+               (double)cfg->fixed_ohms * (cfg->vcc_mv - mv) / mv;
+    double lux = 10.0 * pow((double)cfg->ldr_r10_ohms / r, 1.0 / cfg->ldr_gamma);
+    return (lux >= LIGHT_CAL_LUX_MAX) ? LIGHT_CAL_LUX_MAX : (int)(lux + 0.5);
+}
+
+static inline void light_cal_build(light_cal_t *cal, const light_cal_config_t *cfg,
+                                   light_cal_mv_fn_t mv_of_raw, void *ctx)
+{
+    int full_mv = mv_of_raw(LIGHT_CAL_RAW_MAX, ctx);
+    for (int i = 0; i < LIGHT_CAL_POINTS; i++) {
+        int raw = i << LIGHT_CAL_SHIFT;
+        if (raw > LIGHT_CAL_RAW_MAX) {
+            raw = LIGHT_CAL_RAW_MAX;
+        }
+        int mv = mv_of_raw(raw, ctx);
+        int pct = (full_mv > 0) ? mv * 100 / full_mv : 0;
+        cal->mv[i] = (uint16_t)mv;
+        cal->lux[i] = (uint16_t)light_cal_lux_of_mv(cfg, mv);
+        cal->percent[i] = (uint8_t)(cfg->ldr_to_gnd ? 100 - pct : pct);
+    }
+}
+
+static inline int light_cal_interp(int a, int b, int frac)
+{
+    return a + (((b - a) * frac) >> LIGHT_CAL_SHIFT);
+}
+
+static inline void light_cal_read(const light_cal_t *cal, int raw, light_reading_t *out)
+{
+    raw = (raw < 0) ? 0 : (raw > LIGHT_CAL_RAW_MAX) ? LIGHT_CAL_RAW_MAX : raw;
+    int i = raw >> LIGHT_CAL_SHIFT;
+    int frac = raw & ((1 << LIGHT_CAL_SHIFT) - 1);
+    out->raw = raw;
+    out->mv = light_cal_interp(cal->mv[i], cal->mv[i + 1], frac);
+    out->lux = light_cal_interp(cal->lux[i], cal->lux[i + 1], frac);
+    out->percent = light_cal_interp(cal->percent[i], cal->percent[i + 1], frac);
+}
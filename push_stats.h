@@ -0,0 +1,103 @@
+/*
+ * Telemetry Push Counters - Connection Reuse and Handshake Time Saved
+ *
+ * Shared by the firmware variants that push telemetry. Each push is
+ * timed and filed as either "connected" (it had to open a TCP connection,
+ * plus a TLS handshake or resumption over HTTPS) or "reused" (it went out
+ * on the kept-alive connection).
+ *
+ * Without a persistent client every push opened its own connection. The
+ * mean time of the connecting pushes against the mean of the reused ones
+ * is what a reused push saves; both are measured, so one slow DNS lookup
+ * or handshake only moves the mean a little.
+ *
+ * push_idle_t learns the server's keep-alive timeout: a reused connection
+ * that fails after an idle gap longer than any it survived marks the
+ * limit, and past it the push reconnects up front. Short gaps never teach
+ * it (a transient error is not a timeout), and every PUSH_IDLE_PROBE_EVERY
+ * gaps past the limit the connection is tried anyway, so a limit learned
+ * from a fluke is dropped once a reused push outlives it.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t pushes;
+    uint32_t failures;
+    uint32_t connects;          // Successful pushes that opened a connection
+    uint32_t reused;            // Successful pushes on the open connection
+    uint32_t retries;           // Kept-alive connection found dead, sent again
+    int64_t connect_us;         // Time of all successful connecting pushes
+    int64_t reused_us;          // Time of all successful reused pushes
+} push_stats_t;
+
+static inline void push_stats_note(push_stats_t *st, bool ok, bool reused, int64_t us)
+{
+    st->pushes++;
+    if (!ok) {
+        st->failures++;
+        return;
+    }
+    if (reused) {
+        st->reused++;
+        st->reused_us += us;
+    } else {
+        st->connects++;
+        st->connect_us += us;
+    }
+}
+
+// Mean connecting push minus mean reused push; 0 until both were seen
+static inline int64_t push_stats_saved_per_push_us(const push_stats_t *st)
+{
+    if (st->connects == 0 || st->reused == 0) {
+        return 0;
+    }
+    int64_t saved = st->connect_us / st->connects - st->reused_us / st->reused;
+    return (saved > 0) ? saved : 0;
+}
+
+static inline int64_t push_stats_saved_us(const push_stats_t *st)
+{
+    return push_stats_saved_per_push_us(st) * st->reused;
+}
+
+// ==================== Idle Limit ====================
+
+#define PUSH_IDLE_LEARN_MIN_US  (5 * 1000000LL)
+#define PUSH_IDLE_PROBE_EVERY   16
+
+typedef struct {
+    int64_t limit_us;           // Learned server idle timeout, INT64_MAX until then
+    int64_t ok_us;              // Longest idle gap a reused connection survived
+    uint32_t past_limit;        // Pushes that found the connection idle past the limit
+} push_idle_t;
+
+#define PUSH_IDLE_INIT  { .limit_us = INT64_MAX }
+
+// Whether a push after idle_us should close the kept-alive connection
+// and reconnect up front
+static inline bool push_idle_reconnect(push_idle_t *p, int64_t idle_us)
+{
+    if (idle_us < p->limit_us) {
+        return false;
+    }
+    return (++p->past_limit % PUSH_IDLE_PROBE_EVERY) != 0;
+}
+
+// Outcome of a push on a kept-alive connection idle for idle_us
+static inline void push_idle_note(push_idle_t *p, bool ok, int64_t idle_us)
+{
+    if (ok) {
+        if (idle_us > p->ok_us) {
+            p->ok_us = idle_us;
+        }
+        if (idle_us >= p->limit_us) {
+            p->limit_us = INT64_MAX;    // The server keeps it longer after all
+        }
+    } else if (idle_us >= PUSH_IDLE_LEARN_MIN_US && idle_us > p->ok_us && idle_us < p->limit_us) {
+        p->limit_us = idle_us;
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Sequence Lock - Consistent Snapshots Without Blocking the Writer
+ *
+ * Shared by all three firmware variants for system_state. The writer
+ * bumps the sequence to odd, updates the data, and bumps it back to even;
+ * a reader copies the data and retries if the sequence was odd or moved
+ * meanwhile. Readers never block the writer, and never see a torn mix of
+ * old and new fields.
+ *
+ * Writers must be serialized, and must not be preempted mid-update by a
+ * reader on the same core (it would spin forever): wrap each update in a
+ * critical section (taskENTER_CRITICAL), and keep it to plain stores.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t seq;
+} seqlock_t;
+
+#define SEQLOCK_INIT    { .seq = 0 }
+
+static inline uint32_t seqlock_read_begin(const seqlock_t *sl)
+{
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1) {
+        // Writer busy on the other core; it only holds it for a few stores
+    }
+    return seq;
+}
+
+// True if the data copied since seqlock_read_begin() may be torn
+static inline bool seqlock_read_retry(const seqlock_t *sl, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != seq;
+}
+
+static inline void seqlock_write_begin(seqlock_t *sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(seqlock_t *sl)
+{
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+}
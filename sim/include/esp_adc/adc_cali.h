@@ -0,0 +1,10 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_adc/adc_cali.h
+ */
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct adc_cali_scheme_t *adc_cali_handle_t;
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage);
@@ -0,0 +1,26 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_adc/adc_cali_scheme.h
+ *
+ * The ESP32 only has the line-fitting scheme. Without eFuse values it
+ * uses default_vref and the same per-attenuation coefficients as the real
+ * component, so converted voltages are in the right range.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "hal/adc_types.h"
+#include "esp_adc/adc_cali.h"
+
+#define ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED  1
+
+typedef struct {
+    adc_unit_t unit_id;
+    adc_atten_t atten;
+    adc_bitwidth_t bitwidth;
+    uint32_t default_vref;
+} adc_cali_line_fitting_config_t;
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config,
+                                              adc_cali_handle_t *ret_handle);
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle);
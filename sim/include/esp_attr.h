@@ -0,0 +1,8 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_attr.h
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
@@ -0,0 +1,8 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_crt_bundle.h
+ */
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t esp_crt_bundle_attach(void *conf);
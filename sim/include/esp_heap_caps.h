@@ -0,0 +1,21 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_heap_caps.h
+ *
+ * The simulated board has no PSRAM: MALLOC_CAP_SPIRAM requests fail, so
+ * firmware takes its internal-RAM fallback path.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_DEFAULT      (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
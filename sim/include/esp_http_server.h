@@ -0,0 +1,138 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_http_server.h
+ *
+ * There is no socket: the harness injects requests with
+ * sim_httpd_request() and reads back the captured response. WebSocket
+ * clients are opened with sim_httpd_ws_connect(); frames sent to them go
+ * to the harness observer.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+#define HTTPD_MAX_URI_LEN   512
+
+#define ESP_ERR_HTTPD_BASE              (0xb000)
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ       (ESP_ERR_HTTPD_BASE + 3)
+
+typedef enum http_method {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+    HTTP_OPTIONS = 6,
+} httpd_method_t;
+
+typedef void *httpd_handle_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+    void *sess_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+    const char *supported_subprotocol;
+} httpd_uri_t;
+
+typedef struct httpd_config {
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .task_priority      = 5,            \
+        .stack_size         = 4096,         \
+        .core_id            = 0x7FFFFFFF,   \
+        .server_port        = 80,           \
+        .ctrl_port          = 32768,        \
+        .max_open_sockets   = 7,            \
+        .max_uri_handlers   = 8,            \
+        .max_resp_headers   = 8,            \
+        .backlog_conn       = 5,            \
+        .lru_purge_enable   = false,        \
+        .recv_wait_timeout  = 5,            \
+        .send_wait_timeout  = 5,            \
+}
+
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+#define HTTPD_RESP_USE_STRLEN   -1
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_500(httpd_req_t *r);
+
+int httpd_req_to_sockfd(httpd_req_t *r);
+
+// Runs work in the server task; the simulation has none, so it runs at once
+typedef void (*httpd_work_fn_t)(void *arg);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+
+// ==================== WebSocket (CONFIG_HTTPD_WS_SUPPORT) ====================
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT     = 0x1,
+    HTTPD_WS_TYPE_BINARY   = 0x2,
+    HTTPD_WS_TYPE_CLOSE    = 0x8,
+    HTTPD_WS_TYPE_PING     = 0x9,
+    HTTPD_WS_TYPE_PONG     = 0xA,
+} httpd_ws_type_t;
+
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID   = 0x0,
+    HTTPD_WS_CLIENT_HTTP      = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef struct httpd_ws_frame {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd);
+
+static inline esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+    return httpd_resp_send(r, str, (str == NULL) ? 0 : HTTPD_RESP_USE_STRLEN);
+}
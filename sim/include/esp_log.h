@@ -0,0 +1,37 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_log.h
+ *
+ * Log lines carry the virtual uptime in milliseconds, like the real
+ * console output. The default level is WARN so that long simulated runs
+ * are not dominated by printf cost; sim_main raises it with -v.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+extern esp_log_level_t sim_log_level;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define SIM_LOG_AT(level, tag, format, ...) do {                    \
+        if ((level) <= sim_log_level) {                             \
+            sim_log_write(level, tag, format, ##__VA_ARGS__);       \
+        }                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) SIM_LOG_AT(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SIM_LOG_AT(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SIM_LOG_AT(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) SIM_LOG_AT(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) SIM_LOG_AT(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
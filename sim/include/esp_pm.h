@@ -0,0 +1,21 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_pm.h
+ *
+ * Power management is not modelled; the configuration is accepted so the
+ * firmware's light-sleep setup compiles and runs unchanged.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+
+static inline esp_err_t esp_pm_configure(const void *config)
+{
+    return (config != NULL) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
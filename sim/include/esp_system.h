@@ -0,0 +1,12 @@
+/*
+ * Host simulation stand-in for ESP-IDF esp_system.h
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_bit_defs.h"
+
+uint32_t esp_get_free_heap_size(void);
+void esp_restart(void) __attribute__((noreturn));
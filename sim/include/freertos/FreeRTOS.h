@@ -0,0 +1,53 @@
+/*
+ * Host simulation stand-in for FreeRTOS.h
+ *
+ * The tick rate matches the ESP-IDF default (CONFIG_FREERTOS_HZ=100), so
+ * pdMS_TO_TICKS() rounds exactly the way it does on the board.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_bit_defs.h"
+
+#define configTICK_RATE_HZ      100
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define errQUEUE_EMPTY          ((BaseType_t)0)
+#define errQUEUE_FULL           ((BaseType_t)0)
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) \
+    ((TickType_t)(((uint64_t)(xTimeInMs) * (uint64_t)configTICK_RATE_HZ) / (uint64_t)1000U))
+#define pdTICKS_TO_MS(xTicks) \
+    ((TickType_t)(((uint64_t)(xTicks) * (uint64_t)1000U) / (uint64_t)configTICK_RATE_HZ))
+
+// The simulator is cooperative and single-threaded, so critical sections
+// only need to exist for the code to compile.
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { .owner = 0, .count = 0 }
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void)(mux))
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+#define portYIELD_FROM_ISR(...)         ((void)0)
+#define tskNO_AFFINITY                  0x7FFFFFFF
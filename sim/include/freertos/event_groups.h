@@ -0,0 +1,19 @@
+/*
+ * Host simulation stand-in for FreeRTOS event_groups.h
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct sim_event_group *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit,
+                                const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait);
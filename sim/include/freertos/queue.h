@@ -0,0 +1,27 @@
+/*
+ * Host simulation stand-in for FreeRTOS queue.h
+ *
+ * Items are copied by value exactly as on the board; a blocked receiver is
+ * woken at the virtual instant an item is sent, including from an ISR.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+void vQueueDelete(QueueHandle_t xQueue);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue);
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue,
+                             BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+BaseType_t xQueueReset(QueueHandle_t xQueue);
+
+#define xQueueSendToBack(q, item, ticks)    xQueueSend((q), (item), (ticks))
+#define xQueueSendToBackFromISR(q, item, woken) xQueueSendFromISR((q), (item), (woken))
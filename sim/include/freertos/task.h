@@ -0,0 +1,48 @@
+/*
+ * Host simulation stand-in for FreeRTOS task.h
+ *
+ * Tasks are coroutines scheduled against a virtual clock (see sim_rtos.c).
+ * Only one task runs at a time and virtual time advances only when every
+ * task is blocked, so runs are repeatable and much faster than real time.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+                       uint32_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName,
+                                   uint32_t usStackDepth, void *pvParameters,
+                                   UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(TickType_t xTicksToDelay);
+BaseType_t xTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+#define vTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement) \
+    ((void)xTaskDelayUntil((pxPreviousWakeTime), (xTimeIncrement)))
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+// Direct-to-task notifications (counting semaphore style)
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+// The same notification value used as event bits
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+} eNotifyAction;
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction);
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue, TickType_t xTicksToWait);
+
+#define taskYIELD()     vTaskDelay(0)
@@ -0,0 +1,64 @@
+/*
+ * Host simulation stand-in for the espressif/led_strip component
+ *
+ * Pixels land in an in-memory buffer that the harness inspects. A refresh
+ * blocks the calling task for the WS2812 wire time (30 us per pixel plus
+ * the reset pulse), as led_strip_refresh() does on the board.
+ * led_strip_refresh_async() starts the transfer and returns at once;
+ * strips on different RMT channels transmit at the same time, and
+ * led_strip_refresh_wait_done() blocks until the strip's transfer ends.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct led_strip_t *led_strip_handle_t;
+
+typedef enum {
+    LED_PIXEL_FORMAT_GRB,
+    LED_PIXEL_FORMAT_GRBW,
+    LED_PIXEL_FORMAT_INVALID
+} led_pixel_format_t;
+
+typedef enum {
+    LED_MODEL_WS2812,
+    LED_MODEL_SK6812,
+    LED_MODEL_INVALID
+} led_model_t;
+
+typedef enum {
+    RMT_CLK_SRC_DEFAULT = 0,
+    RMT_CLK_SRC_APB = 0,
+} rmt_clock_source_t;
+
+typedef struct {
+    int strip_gpio_num;
+    uint32_t max_leds;
+    led_pixel_format_t led_pixel_format;
+    led_model_t led_model;
+    struct {
+        uint32_t invert_out: 1;
+    } flags;
+} led_strip_config_t;
+
+typedef struct {
+    rmt_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    struct {
+        uint32_t with_dma: 1;
+    } flags;
+} led_strip_rmt_config_t;
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config,
+                                   const led_strip_rmt_config_t *rmt_config,
+                                   led_strip_handle_t *ret_strip);
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index,
+                              uint32_t red, uint32_t green, uint32_t blue);
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip);
+esp_err_t led_strip_refresh_wait_done(led_strip_handle_t strip);
+esp_err_t led_strip_clear(led_strip_handle_t strip);
+esp_err_t led_strip_del(led_strip_handle_t strip);
@@ -0,0 +1,345 @@
+/*
+ * Host Benchmark - WS2812 Effect Frames: Float/Divide vs Fixed-Point
+ *
+ * Draws frames of each animated effect the way the renderer used to
+ * (sin() in double per frame, hsv_to_rgb() with a division per pixel for
+ * the hue spread, brightness as three divisions by 100 per pixel) and the
+ * way it does now (led_effects.h: sine table, scale8, 8.8 hue steps).
+ * Reports the cost per frame for several strip lengths, and separately
+ * the gamma table lookup the renderer now adds as pixels go out.
+ *
+ * The dithering table lists the PWM value a full channel gets at each low
+ * brightness percentage: rounded through led_gamma8, and averaged over
+ * the LED_DITHER_PHASES frames of led_dither8().
+ *
+ * The power row adds the per-frame current estimate (led_power_ma()) and
+ * limit to the dithered output.
+ *
+ * The compositor table draws the strip split into LED_SEGMENT_MAX
+ * segments with mixed effects (led_compose()), against one effect over
+ * the whole strip.
+ *
+ * The last table is the frame rate a strip of each length can reach:
+ * the renderer sends a frame with led_strip_refresh(), which waits for
+ * the 30 us per pixel on the wire, so long strips are bound by the wire,
+ * not by the effect math. Memory is the two packed GRB frames plus the
+ * led_strip driver's own pixel buffer.
+ *
+ * Host times are a lower bound. The ESP32 has no double-precision FPU,
+ * so the old sin() costs it far more than here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "led_effects.h"
+
+#define FRAME_MS        20
+#define TARGET_NS       200000000.0     // Time spent per measurement
+#define MAX_LEDS        2000
+#define WS2812_US_PER_PIXEL     30
+#define WS2812_RESET_US         50
+#define RENDER_FPS      50
+
+static const uint32_t strip_lengths[] = { 5, 60, 150, 300, 1000, 2000 };
+static const uint32_t fps_lengths[] = { 5, 60, 150, 300, 500, 660, 1000, 1500, 2000 };
+
+typedef enum {
+    FX_BREATH,
+    FX_RAINBOW,
+    FX_RAINBOW_CYCLE,
+} fx_t;
+
+static const char *fx_names[] = { "breath", "rainbow", "cycle" };
+
+// Parameters the firmware takes from system_state
+static const rgb_t color = { 255, 180, 40 };
+static volatile uint8_t brightness = 80;    // Percent; volatile so it is not folded in
+
+static rgb_t frame_rgb[MAX_LEDS];
+static grb_t frame[MAX_LEDS];
+static uint8_t wire[MAX_LEDS * 3];
+static volatile uint32_t s_sink;
+
+// ==================== Before: Float and Division ====================
+
+static void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    if (s == 0) {
+        *r = v; *g = v; *b = v;
+        return;
+    }
+
+    uint8_t region = h / 43;
+    uint8_t remainder = (h - (region * 43)) * 6;
+    uint8_t p = (v * (255 - s)) >> 8;
+    uint8_t q = (v * (255 - ((s * remainder) >> 8))) >> 8;
+    uint8_t t = (v * (255 - ((s * (255 - remainder)) >> 8))) >> 8;
+
+    switch (region) {
+        case 0: *r = v; *g = t; *b = p; break;
+        case 1: *r = q; *g = v; *b = p; break;
+        case 2: *r = p; *g = v; *b = t; break;
+        case 3: *r = p; *g = q; *b = v; break;
+        case 4: *r = t; *g = p; *b = v; break;
+        default: *r = v; *g = p; *b = q; break;
+    }
+}
+
+static void apply_brightness(uint8_t *r, uint8_t *g, uint8_t *b, uint8_t pct)
+{
+    *r = (*r * pct) / 100;
+    *g = (*g * pct) / 100;
+    *b = (*b * pct) / 100;
+}
+
+static void frame_old(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    uint8_t hue = (uint8_t)(t_ms / 50);
+    uint8_t pct = brightness;
+    uint8_t r, g, b;
+    switch (fx) {
+        case FX_BREATH: {
+            double factor = (sin(t_ms / 1000.0) + 1.0) / 2.0;
+            uint8_t level = pct * factor;
+            r = (color.r * level) / 100;
+            g = (color.g * level) / 100;
+            b = (color.b * level) / 100;
+            for (uint32_t i = 0; i < n; i++) {
+                frame_rgb[i] = (rgb_t){ r, g, b };
+            }
+            break;
+        }
+        case FX_RAINBOW:
+            hsv_to_rgb(hue, 255, 255, &r, &g, &b);
+            apply_brightness(&r, &g, &b, pct);
+            for (uint32_t i = 0; i < n; i++) {
+                frame_rgb[i] = (rgb_t){ r, g, b };
+            }
+            break;
+        case FX_RAINBOW_CYCLE:
+            for (uint32_t i = 0; i < n; i++) {
+                hsv_to_rgb((hue + (i * 256 / n)) % 256, 255, 255, &r, &g, &b);
+                apply_brightness(&r, &g, &b, pct);
+                frame_rgb[i] = (rgb_t){ r, g, b };
+            }
+            break;
+    }
+}
+
+// ==================== After: led_effects.h ====================
+
+static void frame_new(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    uint8_t hue = (uint8_t)(t_ms / 50);
+    uint8_t scale = led_percent_to_scale(brightness);
+    switch (fx) {
+        case FX_BREATH:
+            led_fx_breath(frame, n, color, scale, t_ms);
+            break;
+        case FX_RAINBOW:
+            led_fx_rainbow(frame, n, hue, scale);
+            break;
+        case FX_RAINBOW_CYCLE:
+            led_fx_rainbow_cycle(frame, n, hue, scale);
+            break;
+    }
+}
+
+// ==================== Output Stage ====================
+
+// GRB bytes as the strip driver sends them, plain or through the gamma table
+static void out_plain(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    (void)fx;
+    frame_rgb[t_ms % n].r = (uint8_t)t_ms;
+    for (uint32_t i = 0; i < n; i++) {
+        wire[3 * i] = frame_rgb[i].g;
+        wire[3 * i + 1] = frame_rgb[i].r;
+        wire[3 * i + 2] = frame_rgb[i].b;
+    }
+}
+
+// A packed GRB frame is already in wire order: one table lookup per byte
+static void out_gamma(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    (void)fx;
+    frame[t_ms % n].r = (uint8_t)t_ms;
+    const uint8_t *src = (const uint8_t *)frame;
+    for (uint32_t i = 0; i < n * 3; i++) {
+        wire[i] = led_gamma8[src[i]];
+    }
+}
+
+// The same with temporal dithering, as frame_show() does by default
+static void out_dither(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    (void)fx;
+    frame[t_ms % n].r = (uint8_t)t_ms;
+    const uint8_t *src = (const uint8_t *)frame;
+    bool fraction = false;
+    for (uint32_t i = 0; i < n * 3; i++) {
+        wire[i] = led_dither8(src[i], (uint8_t)(t_ms / FRAME_MS + i / 3), &fraction);
+    }
+    s_sink += fraction;
+}
+
+// Dithered output behind the power estimate and limit, as frame_show()
+static void out_limited(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    uint32_t ma = led_power_ma(led_frame_pwm_sum(frame, n), n);
+    uint8_t limit = led_power_scale(ma, n, 2000);
+    out_dither(fx, n, t_ms);
+    if (limit < 255) {
+        for (uint32_t i = 0; i < n * 3; i++) {
+            wire[i] = scale8(wire[i], limit);
+        }
+    }
+}
+
+// What the renderer does per frame on the longest path: rainbow cycle
+// plus the gamma pass
+static void frame_full(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    frame_new(fx, n, t_ms);
+    out_gamma(fx, n, t_ms);
+}
+
+// ==================== Compositor ====================
+
+static led_segments_t s_zones;
+
+static void compose_zones(uint32_t n, uint32_t zones)
+{
+    static const light_effect_t effects[] = { EFFECT_BREATH, EFFECT_RAINBOW, EFFECT_RAINBOW_CYCLE };
+    memset(&s_zones, 0, sizeof(s_zones));
+    for (uint32_t i = 0; i < zones; i++) {
+        led_segment_t seg = {
+            .start = (uint16_t)(i * n / zones),
+            .len = (uint16_t)(n / zones),
+            .effect = effects[i % 3],
+            .brightness = 90,
+            .speed = (uint8_t)(20 + i * 10),
+            .color = { (uint8_t)(i * 97), (uint8_t)(i * 53 + 80), (uint8_t)(255 - i * 31) },
+        };
+        snprintf(seg.name, sizeof(seg.name), "zone%u", i);
+        led_segment_put(&s_zones, &seg);
+    }
+}
+
+static void frame_compose(fx_t fx, uint32_t n, uint32_t t_ms)
+{
+    const led_segment_t base = { .effect = EFFECT_NONE, .brightness = 100, .speed = 50, .color = color };
+    led_compose(frame, n, &base, &s_zones, led_percent_to_scale(brightness), t_ms);
+    (void)fx;
+}
+
+typedef void (*frame_fn_t)(fx_t fx, uint32_t n, uint32_t t_ms);
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Nanoseconds per frame, drawing consecutive frames of the effect
+static double time_frames(frame_fn_t fn, fx_t fx, uint32_t n)
+{
+    uint32_t frames = 0;
+    uint32_t t_ms = 0;
+    double t0 = now_ns();
+    double elapsed;
+    do {
+        for (int k = 0; k < 64; k++) {
+            fn(fx, n, t_ms);
+            t_ms += FRAME_MS;
+            s_sink += frame[(frames + k) % n].g + frame_rgb[(frames + k) % n].g +
+                      wire[(frames + k) % (n * 3)];
+        }
+        frames += 64;
+        elapsed = now_ns() - t0;
+    } while (elapsed < TARGET_NS);
+    return elapsed / frames;
+}
+
+static void print_row(const char *label, uint32_t n, double before, double after)
+{
+    printf("  %-8s %6u %12.2f %12.2f %8.1fx %10.2f\n",
+           label, n, before / 1e3, after / 1e3, before / after, after / n);
+}
+
+int main(void)
+{
+    printf("effect frames %d ms apart, host CPU time (a 100 fps budget is 10000 us)\n", FRAME_MS);
+    printf("  %-8s %6s %12s %12s %9s %10s\n", "effect", "leds", "before us", "after us", "speedup", "ns/pixel");
+    for (int fx = FX_BREATH; fx <= FX_RAINBOW_CYCLE; fx++) {
+        for (size_t k = 0; k < sizeof(strip_lengths) / sizeof(strip_lengths[0]); k++) {
+            uint32_t n = strip_lengths[k];
+            print_row(fx_names[fx], n, time_frames(frame_old, (fx_t)fx, n),
+                      time_frames(frame_new, (fx_t)fx, n));
+        }
+    }
+    printf("output stage: GRB copy before, gamma table after\n");
+    for (size_t k = 0; k < sizeof(strip_lengths) / sizeof(strip_lengths[0]); k++) {
+        uint32_t n = strip_lengths[k];
+        print_row("gamma", n, time_frames(out_plain, FX_BREATH, n), time_frames(out_gamma, FX_BREATH, n));
+    }
+
+    printf("output stage: gamma table before, dithered after\n");
+    for (size_t k = 0; k < sizeof(strip_lengths) / sizeof(strip_lengths[0]); k++) {
+        uint32_t n = strip_lengths[k];
+        print_row("dither", n, time_frames(out_gamma, FX_BREATH, n), time_frames(out_dither, FX_BREATH, n));
+    }
+    printf("output stage: dithered before, with the power estimate and a 2000 mA limit after\n");
+    led_fx_solid(frame, MAX_LEDS, color, 255);
+    for (size_t k = 0; k < sizeof(strip_lengths) / sizeof(strip_lengths[0]); k++) {
+        uint32_t n = strip_lengths[k];
+        print_row("power", n, time_frames(out_dither, FX_BREATH, n), time_frames(out_limited, FX_BREATH, n));
+    }
+
+    printf("dithering: PWM value of a full channel at low brightness (gamma8 / dithered average)\n");
+    int steps8 = 0, steps_dither = 0;
+    double last8 = 0, last_dither = 0;
+    for (int pct = 1; pct <= 20; pct++) {
+        uint8_t v = scale8(255, led_percent_to_scale((uint8_t)pct));
+        double avg = 0;
+        bool fraction = false;
+        for (int ph = 0; ph < LED_DITHER_PHASES; ph++) {
+            avg += led_dither8(v, (uint8_t)ph, &fraction);
+        }
+        avg /= LED_DITHER_PHASES;
+        steps8 += (led_gamma8[v] != last8);
+        steps_dither += (avg != last_dither);
+        last8 = led_gamma8[v];
+        last_dither = avg;
+        printf("  %3d%%  %5u  %6.2f\n", pct, led_gamma8[v], avg);
+    }
+    printf("  distinct levels over 1..20%%: %d rounded, %d dithered\n", steps8, steps_dither);
+
+    printf("compositor: one rainbow cycle over the strip vs %d segments (breath/rainbow/cycle)\n",
+           LED_SEGMENT_MAX);
+    for (size_t k = 0; k < sizeof(strip_lengths) / sizeof(strip_lengths[0]); k++) {
+        uint32_t n = strip_lengths[k];
+        if (n < LED_SEGMENT_MAX) {
+            continue;
+        }
+        compose_zones(n, LED_SEGMENT_MAX);
+        print_row("zones", n, time_frames(frame_new, FX_RAINBOW_CYCLE, n),
+                  time_frames(frame_compose, FX_RAINBOW_CYCLE, n));
+    }
+
+    printf("frame rate vs strip length (rainbow cycle, frame clock %d fps)\n", RENDER_FPS);
+    printf("  %6s %10s %10s %10s %10s %10s\n", "leds", "cpu us", "wire us", "max fps", "at clock", "ram bytes");
+    for (size_t k = 0; k < sizeof(fps_lengths) / sizeof(fps_lengths[0]); k++) {
+        uint32_t n = fps_lengths[k];
+        double cpu_us = time_frames(frame_full, FX_RAINBOW_CYCLE, n) / 1e3;
+        double wire_us = (double)n * WS2812_US_PER_PIXEL + WS2812_RESET_US;
+        double fps = 1e6 / (cpu_us + wire_us);
+        printf("  %6u %10.2f %10.0f %10.1f %10.1f %10u\n", n, cpu_us, wire_us, fps,
+               fps < RENDER_FPS ? fps : RENDER_FPS, (unsigned)(3 * n * sizeof(grb_t)));
+    }
+    return 0;
+}
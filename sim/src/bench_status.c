@@ -0,0 +1,240 @@
+/*
+ * Host Benchmark - /status Payload: cJSON Tree vs json_writer.h
+ *
+ * Builds the relay and WS2812 /status payloads the way the firmware used
+ * to (cJSON tree + cJSON_Print + free) and the way it does now (stack
+ * buffer + json_writer.h), and reports size, time and heap churn per
+ * request. Heap use is counted through cJSON_InitHooks; the writer path
+ * has no allocator to hook, so any count there would be a bug.
+ *
+ * The cJSON side is the simulator's stand-in (same allocation pattern as
+ * the real library); absolute times on the ESP32 are several times higher.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "json_writer.h"
+
+#define ITERATIONS      200000
+#define STATUS_JSON_MAX 256
+
+typedef struct {
+    bool is_auto_mode;
+    bool is_light_on;
+    int light_value;
+    int light_mv;
+    int light_lux;
+    int light_percent;
+    bool motion_detected;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t brightness;
+    int effect;
+} status_t;
+
+static struct {
+    unsigned long long mallocs;
+    unsigned long long bytes;
+    long long live;
+    long long peak;
+} s_heap;
+
+// Size header in front of each block, so frees can be accounted
+static void *counting_malloc(size_t sz)
+{
+    size_t *p = malloc(sizeof(size_t) + sz);
+    if (p == NULL) {
+        return NULL;
+    }
+    *p = sz;
+    s_heap.mallocs++;
+    s_heap.bytes += sz;
+    s_heap.live += (long long)sz;
+    if (s_heap.live > s_heap.peak) {
+        s_heap.peak = s_heap.live;
+    }
+    return p + 1;
+}
+
+static void counting_free(void *ptr)
+{
+    if (ptr != NULL) {
+        size_t *p = (size_t *)ptr - 1;
+        s_heap.live -= (long long)*p;
+        free(p);
+    }
+}
+
+// Output sink, so neither path can be optimised away
+static volatile size_t s_sink;
+
+static size_t relay_cjson(const status_t *s, char *out, size_t cap)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "lightOn", s->is_light_on);
+    cJSON_AddBoolToObject(root, "autoMode", s->is_auto_mode);
+    cJSON_AddNumberToObject(root, "lightValue", s->light_value);
+    cJSON_AddNumberToObject(root, "lightPercent", s->light_percent);
+    cJSON_AddNumberToObject(root, "lightMv", s->light_mv);
+    cJSON_AddNumberToObject(root, "lux", s->light_lux);
+    cJSON_AddBoolToObject(root, "motion", s->motion_detected);
+    char *json_str = cJSON_Print(root);
+    // The response goes out from the caller's buffer, as httpd_resp_send would copy it
+    size_t len = strlen(json_str);
+    if (len >= cap) {
+        len = cap - 1;
+    }
+    memcpy(out, json_str, len);
+    out[len] = '\0';
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return len;
+}
+
+static size_t relay_writer(const status_t *s, char *out, size_t cap)
+{
+    json_writer_t w;
+    json_writer_init(&w, out, cap);
+    json_obj_begin(&w, NULL);
+    json_add_bool(&w, "lightOn", s->is_light_on);
+    json_add_bool(&w, "autoMode", s->is_auto_mode);
+    json_add_int(&w, "lightValue", s->light_value);
+    json_add_int(&w, "lightPercent", s->light_percent);
+    json_add_int(&w, "lightMv", s->light_mv);
+    json_add_int(&w, "lux", s->light_lux);
+    json_add_bool(&w, "motion", s->motion_detected);
+    json_obj_end(&w);
+    return json_writer_ok(&w) ? w.len : 0;
+}
+
+static size_t ws2812_cjson(const status_t *s, char *out, size_t cap)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "auto_mode", s->is_auto_mode);
+    cJSON_AddBoolToObject(root, "light_on", s->is_light_on);
+    cJSON_AddNumberToObject(root, "light_value", s->light_value);
+    cJSON_AddNumberToObject(root, "light_mv", s->light_mv);
+    cJSON_AddNumberToObject(root, "light_lux", s->light_lux);
+    cJSON_AddNumberToObject(root, "light_percent", s->light_percent);
+    cJSON_AddBoolToObject(root, "motion", s->motion_detected);
+    cJSON_AddNumberToObject(root, "red", s->red);
+    cJSON_AddNumberToObject(root, "green", s->green);
+    cJSON_AddNumberToObject(root, "blue", s->blue);
+    cJSON_AddNumberToObject(root, "brightness", s->brightness);
+    cJSON_AddNumberToObject(root, "effect", s->effect);
+    char *json_str = cJSON_Print(root);
+    // The response goes out from the caller's buffer, as httpd_resp_send would copy it
+    size_t len = strlen(json_str);
+    if (len >= cap) {
+        len = cap - 1;
+    }
+    memcpy(out, json_str, len);
+    out[len] = '\0';
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return len;
+}
+
+static size_t ws2812_writer(const status_t *s, char *out, size_t cap)
+{
+    json_writer_t w;
+    json_writer_init(&w, out, cap);
+    json_obj_begin(&w, NULL);
+    json_add_bool(&w, "auto_mode", s->is_auto_mode);
+    json_add_bool(&w, "light_on", s->is_light_on);
+    json_add_int(&w, "light_value", s->light_value);
+    json_add_int(&w, "light_mv", s->light_mv);
+    json_add_int(&w, "light_lux", s->light_lux);
+    json_add_int(&w, "light_percent", s->light_percent);
+    json_add_bool(&w, "motion", s->motion_detected);
+    json_add_int(&w, "red", s->red);
+    json_add_int(&w, "green", s->green);
+    json_add_int(&w, "blue", s->blue);
+    json_add_int(&w, "brightness", s->brightness);
+    json_add_int(&w, "effect", s->effect);
+    json_obj_end(&w);
+    return json_writer_ok(&w) ? w.len : 0;
+}
+
+typedef size_t (*build_fn_t)(const status_t *s, char *out, size_t cap);
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run(const char *label, build_fn_t fn)
+{
+    status_t s = {
+        .is_auto_mode = true, .light_value = 3012, .light_mv = 2567, .light_lux = 3,
+        .light_percent = 25, .red = 255, .green = 180, .blue = 40, .brightness = 80,
+    };
+    memset(&s_heap, 0, sizeof(s_heap));
+    char out[512];
+    size_t bytes = 0;
+    double t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        // Vary the values the way a live device would
+        s.light_value = 2900 + (i & 255);
+        s.motion_detected = (i & 8) != 0;
+        s.is_light_on = (i & 16) != 0;
+        bytes = fn(&s, out, sizeof(out));
+        s_sink += (unsigned char)out[bytes / 2];
+    }
+    double ns = (now_ns() - t0) / ITERATIONS;
+    printf("  %-16s %4zu bytes  %7.0f ns  %5.1f mallocs  %6.0f heap bytes  peak %lld B\n",
+           label, bytes, ns, (double)s_heap.mallocs / ITERATIONS,
+           (double)s_heap.bytes / ITERATIONS, s_heap.peak);
+}
+
+// Re-print a payload without whitespace, so both paths compare byte for byte
+static char *canonical(const char *json)
+{
+    cJSON *root = cJSON_Parse(json);
+    char *out = (root != NULL) ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    return out;
+}
+
+// Both paths must describe the same object, and the writer must emit it compact
+static bool same_payload(const char *label, build_fn_t tree, build_fn_t writer)
+{
+    status_t s = { .is_auto_mode = true, .light_value = 4095, .light_mv = 3441, .light_lux = 0,
+                   .light_percent = 0, .motion_detected = true, .red = 1, .brightness = 100 };
+    char a[512], b[512];
+    tree(&s, a, sizeof(a));
+    writer(&s, b, sizeof(b));
+    char *ca = canonical(a);
+    char *cb = canonical(b);
+    bool ok = ca != NULL && cb != NULL && strcmp(ca, cb) == 0 && strcmp(cb, b) == 0;
+    if (!ok) {
+        printf("  %s: payloads differ\n    %s\n    %s\n", label, a, b);
+    }
+    cJSON_free(ca);
+    cJSON_free(cb);
+    return ok;
+}
+
+int main(void)
+{
+    cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = counting_free };
+    cJSON_InitHooks(&hooks);
+
+    printf("/status payload, %d requests each\n", ITERATIONS);
+    printf("relay builds (smartlight.c, smartlightrgb.c):\n");
+    run("cJSON_Print", relay_cjson);
+    run("json_writer", relay_writer);
+    printf("ws2812 build (smartlightws2812.c):\n");
+    run("cJSON_Print", ws2812_cjson);
+    run("json_writer", ws2812_writer);
+    bool ok = same_payload("relay", relay_cjson, relay_writer);
+    ok = same_payload("ws2812", ws2812_cjson, ws2812_writer) && ok;
+    printf("payloads %s\n", ok ? "match" : "DIFFER");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/*
+ * Host Benchmark - Telemetry Batch: JSON vs Delta-Packed CBOR
+ *
+ * Loads the recorded samples in sensor_data_7days.json, cuts them into
+ * batches of TELEMETRY_BATCH_MAX records as the push does, and encodes
+ * each batch as the firmware's JSON batch (json_writer.h) and as CBOR
+ * (telemetry_cbor.h). Reports bytes and encode time per record, then
+ * decodes every CBOR batch and checks it gives back the same records.
+ *
+ * Absolute times on the ESP32 are several times higher; the ratio holds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "json_writer.h"
+#include "telemetry_cbor.h"
+
+#define TELEMETRY_BATCH_MAX     32
+#define BATCH_BODY_MAX          (192 + TELEMETRY_BATCH_MAX * 192)
+#define ITERATIONS              2000
+#define DEVICE_ID               "ESP32_SMART_LIGHT_001"
+
+// Output sink, so neither path can be optimised away
+static volatile size_t s_sink;
+
+// Same body as telemetry_batch_json() in smartlight.c
+static size_t batch_json(char *buf, size_t cap, const telemetry_record_t *rec, uint32_t n)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, cap);
+    json_obj_begin(&w, NULL);
+    json_add_str(&w, "deviceId", DEVICE_ID);
+    json_arr_begin(&w, "records");
+    for (uint32_t i = 0; i < n; i++) {
+        json_obj_begin(&w, NULL);
+        json_add_int(&w, "timestamp", (int32_t)(rec[i].t_ms / 1000));
+        json_add_int(&w, "ms", (int32_t)(rec[i].t_ms % 1000));
+        json_add_str(&w, "event", telemetry_kind_name(rec[i].kind));
+        json_add_int(&w, "lightValue", rec[i].light_value);
+        json_add_int(&w, "lightPercent", rec[i].light_percent);
+        json_add_int(&w, "lightMv", rec[i].light_mv);
+        json_add_int(&w, "lux", rec[i].light_lux);
+        json_add_bool(&w, "motion", rec[i].motion);
+        json_add_bool(&w, "lightOn", rec[i].light_on);
+        json_add_bool(&w, "autoMode", rec[i].auto_mode);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    return json_writer_ok(&w) ? w.len : 0;
+}
+
+static size_t batch_cbor(char *buf, size_t cap, const telemetry_record_t *rec, uint32_t n)
+{
+    return telemetry_cbor_batch((uint8_t *)buf, cap, DEVICE_ID, rec, n, NULL);
+}
+
+typedef size_t (*encode_fn_t)(char *buf, size_t cap, const telemetry_record_t *rec, uint32_t n);
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static telemetry_record_t *load_records(const char *path, uint32_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = malloc((size_t)size + 1);
+    text[fread(text, 1, (size_t)size, f)] = '\0';
+    fclose(f);
+
+    cJSON *root = cJSON_Parse(text);
+    free(text);
+    if (!cJSON_IsArray(root)) {
+        fprintf(stderr, "%s: not a JSON array\n", path);
+        cJSON_Delete(root);
+        return NULL;
+    }
+    uint32_t n = (uint32_t)cJSON_GetArraySize(root);
+    telemetry_record_t *rec = calloc(n, sizeof(*rec));
+    uint32_t i = 0;
+    for (cJSON *item = root->child; item != NULL; item = item->next, i++) {
+        int value = cJSON_GetObjectItem(item, "lightValue")->valueint;
+        rec[i] = (telemetry_record_t){
+            .t_ms = (int64_t)cJSON_GetObjectItem(item, "timestamp")->valueint * 1000,
+            .light_value = (uint16_t)value,
+            .light_percent = (uint8_t)cJSON_GetObjectItem(item, "lightPercent")->valueint,
+            // The recording predates the calibrated fields; approximate them
+            .light_mv = (uint16_t)(value * 3300 / 4095),
+            .light_lux = (uint16_t)((4095 - value) / 8),
+            .kind = TELEMETRY_SAMPLE,
+            .motion = cJSON_IsTrue(cJSON_GetObjectItem(item, "motion")),
+            .light_on = cJSON_IsTrue(cJSON_GetObjectItem(item, "lightOn")),
+            .auto_mode = cJSON_IsTrue(cJSON_GetObjectItem(item, "autoMode")),
+        };
+    }
+    cJSON_Delete(root);
+    *count = n;
+    return rec;
+}
+
+static size_t run(const char *label, encode_fn_t fn, const telemetry_record_t *rec, uint32_t n,
+                  double *ns_per_record)
+{
+    char body[BATCH_BODY_MAX];
+    size_t bytes = 0;
+    double t0 = now_ns();
+    for (int it = 0; it < ITERATIONS; it++) {
+        bytes = 0;
+        for (uint32_t i = 0; i < n; i += TELEMETRY_BATCH_MAX) {
+            uint32_t m = (n - i < TELEMETRY_BATCH_MAX) ? n - i : TELEMETRY_BATCH_MAX;
+            size_t len = fn(body, sizeof(body), rec + i, m);
+            s_sink += (unsigned char)body[len / 2];
+            bytes += len;
+        }
+    }
+    *ns_per_record = (now_ns() - t0) / ITERATIONS / n;
+    printf("  %-6s %7zu bytes  %6.1f bytes/record  %6.0f ns/record\n",
+           label, bytes, (double)bytes / n, *ns_per_record);
+    return bytes;
+}
+
+static bool same_record(const telemetry_record_t *a, const telemetry_record_t *b)
+{
+    return a->t_ms == b->t_ms && a->kind == b->kind && a->light_value == b->light_value &&
+           a->light_percent == b->light_percent && a->light_mv == b->light_mv &&
+           a->light_lux == b->light_lux && a->motion == b->motion &&
+           a->light_on == b->light_on && a->auto_mode == b->auto_mode;
+}
+
+// Every batch must decode to exactly the records that went in
+static bool round_trip(const telemetry_record_t *rec, uint32_t n)
+{
+    char body[BATCH_BODY_MAX];
+    telemetry_record_t out[TELEMETRY_BATCH_MAX];
+    for (uint32_t i = 0; i < n; i += TELEMETRY_BATCH_MAX) {
+        uint32_t m = (n - i < TELEMETRY_BATCH_MAX) ? n - i : TELEMETRY_BATCH_MAX;
+        size_t len = batch_cbor(body, sizeof(body), rec + i, m);
+        telemetry_cbor_info_t info;
+        if (telemetry_cbor_decode((const uint8_t *)body, len, &info, out, TELEMETRY_BATCH_MAX) != len ||
+            info.count != m || strcmp(info.device_id, DEVICE_ID) != 0) {
+            printf("  batch at record %u does not decode\n", i);
+            return false;
+        }
+        for (uint32_t k = 0; k < m; k++) {
+            if (!same_record(&rec[i + k], &out[k])) {
+                printf("  record %u differs after decoding\n", i + k);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "../sensor_data_7days.json";
+    uint32_t n;
+    telemetry_record_t *rec = load_records(path, &n);
+    if (rec == NULL || n == 0) {
+        return 1;
+    }
+
+    printf("telemetry batches of %d, %u recorded samples from %s, %d passes\n",
+           TELEMETRY_BATCH_MAX, n, path, ITERATIONS);
+    double json_ns, cbor_ns;
+    size_t json_bytes = run("JSON", batch_json, rec, n, &json_ns);
+    size_t cbor_bytes = run("CBOR", batch_cbor, rec, n, &cbor_ns);
+    printf("  CBOR is %.1fx smaller and %.1fx faster to encode\n",
+           (double)json_bytes / cbor_bytes, json_ns / cbor_ns);
+    bool ok = round_trip(rec, n);
+    printf("CBOR round trip %s\n", ok ? "matches" : "DIFFERS");
+    free(rec);
+    return ok ? 0 : 1;
+}
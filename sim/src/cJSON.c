@@ -0,0 +1,503 @@
+/*
+ * Host Simulation - Minimal cJSON Stand-in
+ *
+ * Enough of cJSON for the firmware: building flat objects/arrays,
+ * printing them (formatted like cJSON_Print, with tabs and newlines) and
+ * parsing the small request bodies the HTTP handlers receive.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include "cJSON.h"
+
+static void *(*s_malloc)(size_t) = malloc;
+static void (*s_free)(void *) = free;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks)
+{
+    s_malloc = (hooks && hooks->malloc_fn) ? hooks->malloc_fn : malloc;
+    s_free = (hooks && hooks->free_fn) ? hooks->free_fn : free;
+}
+
+void cJSON_free(void *object)
+{
+    s_free(object);
+}
+
+static char *dup_string(const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *copy = s_malloc(len);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+static cJSON *new_item(int type)
+{
+    cJSON *item = s_malloc(sizeof(cJSON));
+    if (item != NULL) {
+        memset(item, 0, sizeof(cJSON));
+        item->type = type;
+    }
+    return item;
+}
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item != NULL) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        if (item->valuestring != NULL) {
+            s_free(item->valuestring);
+        }
+        if (item->string != NULL) {
+            s_free(item->string);
+        }
+        s_free(item);
+        item = next;
+    }
+}
+
+// ==================== Construction ====================
+
+cJSON *cJSON_CreateObject(void)
+{
+    return new_item(cJSON_Object);
+}
+
+cJSON *cJSON_CreateArray(void)
+{
+    return new_item(cJSON_Array);
+}
+
+cJSON *cJSON_CreateNumber(double num)
+{
+    cJSON *item = new_item(cJSON_Number);
+    if (item != NULL) {
+        item->valuedouble = num;
+        item->valueint = (num >= 2147483647.0) ? 2147483647 :
+                         (num <= -2147483648.0) ? (-2147483647 - 1) : (int)num;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateString(const char *string)
+{
+    cJSON *item = new_item(cJSON_String);
+    if (item != NULL) {
+        item->valuestring = dup_string(string);
+        if (item->valuestring == NULL) {
+            cJSON_Delete(item);
+            return NULL;
+        }
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateBool(cJSON_bool boolean)
+{
+    return new_item(boolean ? cJSON_True : cJSON_False);
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    if (array == NULL || item == NULL) {
+        return 0;
+    }
+    if (array->child == NULL) {
+        array->child = item;
+        item->prev = item;
+    } else {
+        cJSON *last = array->child->prev;
+        last->next = item;
+        item->prev = last;
+        array->child->prev = item;
+    }
+    item->next = NULL;
+    return 1;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
+{
+    if (object == NULL || string == NULL || item == NULL) {
+        return 0;
+    }
+    item->string = dup_string(string);
+    if (item->string == NULL) {
+        return 0;
+    }
+    return cJSON_AddItemToArray(object, item);
+}
+
+static cJSON *add_or_delete(cJSON *object, const char *name, cJSON *item)
+{
+    if (cJSON_AddItemToObject(object, name, item)) {
+        return item;
+    }
+    cJSON_Delete(item);
+    return NULL;
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    return add_or_delete(object, name, cJSON_CreateNumber(number));
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    return add_or_delete(object, name, cJSON_CreateString(string));
+}
+
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, cJSON_bool boolean)
+{
+    return add_or_delete(object, name, cJSON_CreateBool(boolean));
+}
+
+// ==================== Queries ====================
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string)
+{
+    if (object == NULL || string == NULL) {
+        return NULL;
+    }
+    for (cJSON *c = object->child; c != NULL; c = c->next) {
+        if (c->string != NULL && strcasecmp(c->string, string) == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+int cJSON_GetArraySize(const cJSON *array)
+{
+    int n = 0;
+    for (cJSON *c = array ? array->child : NULL; c != NULL; c = c->next) {
+        n++;
+    }
+    return n;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index)
+{
+    cJSON *c = array ? array->child : NULL;
+    while (c != NULL && index-- > 0) {
+        c = c->next;
+    }
+    return c;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_False; }
+cJSON_bool cJSON_IsTrue(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_True; }
+cJSON_bool cJSON_IsBool(const cJSON *item) { return item && (item->type & (cJSON_True | cJSON_False)) != 0; }
+cJSON_bool cJSON_IsNull(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_NULL; }
+cJSON_bool cJSON_IsNumber(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_Number; }
+cJSON_bool cJSON_IsString(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_String; }
+cJSON_bool cJSON_IsArray(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_Array; }
+cJSON_bool cJSON_IsObject(const cJSON *item) { return item && (item->type & 0xFF) == cJSON_Object; }
+
+// ==================== Printing ====================
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int depth;
+    int format;
+} printbuf_t;
+
+// Grows by doubling through malloc/copy/free, as cJSON's ensure() does
+static int ensure(printbuf_t *p, size_t needed)
+{
+    if (p->len + needed < p->cap) {
+        return 1;
+    }
+    size_t cap = p->cap ? p->cap : 256;
+    while (p->len + needed >= cap) {
+        cap *= 2;
+    }
+    char *grown = s_malloc(cap);
+    if (grown == NULL) {
+        return 0;
+    }
+    if (p->buf != NULL) {
+        memcpy(grown, p->buf, p->len);
+        s_free(p->buf);
+    }
+    p->buf = grown;
+    p->cap = cap;
+    return 1;
+}
+
+static int append(printbuf_t *p, const char *s, size_t n)
+{
+    if (!ensure(p, n + 1)) {
+        return 0;
+    }
+    memcpy(p->buf + p->len, s, n);
+    p->len += n;
+    p->buf[p->len] = '\0';
+    return 1;
+}
+
+static int append_str(printbuf_t *p, const char *s)
+{
+    return append(p, s, strlen(s));
+}
+
+static int print_string(printbuf_t *p, const char *s)
+{
+    if (!append(p, "\"", 1)) {
+        return 0;
+    }
+    for (; *s; s++) {
+        char esc[8];
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            if (!append(p, esc, 2)) return 0;
+        } else if (c < 0x20) {
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            if (!append_str(p, esc)) return 0;
+        } else if (!append(p, (const char *)s, 1)) {
+            return 0;
+        }
+    }
+    return append(p, "\"", 1);
+}
+
+static int print_number(printbuf_t *p, double d)
+{
+    char num[32];
+    if (isnan(d) || isinf(d)) {
+        snprintf(num, sizeof(num), "null");
+    } else if (d == (double)(long long)d) {
+        snprintf(num, sizeof(num), "%lld", (long long)d);
+    } else {
+        snprintf(num, sizeof(num), "%1.15g", d);
+    }
+    return append_str(p, num);
+}
+
+static int print_value(printbuf_t *p, const cJSON *item);
+
+static int print_indent(printbuf_t *p)
+{
+    for (int i = 0; i < p->depth; i++) {
+        if (!append(p, "\t", 1)) return 0;
+    }
+    return 1;
+}
+
+static int print_container(printbuf_t *p, const cJSON *item, int is_object)
+{
+    if (!append(p, is_object ? "{" : "[", 1)) return 0;
+    p->depth++;
+    if (p->format && is_object && item->child) {
+        if (!append(p, "\n", 1)) return 0;
+    }
+    for (const cJSON *c = item->child; c != NULL; c = c->next) {
+        if (is_object) {
+            if (p->format && !print_indent(p)) return 0;
+            if (!print_string(p, c->string)) return 0;
+            if (!append_str(p, p->format ? ":\t" : ":")) return 0;
+        }
+        if (!print_value(p, c)) return 0;
+        if (c->next && !append(p, ",", 1)) return 0;
+        if (p->format) {
+            if (!append_str(p, is_object ? "\n" : (c->next ? " " : ""))) return 0;
+        }
+    }
+    p->depth--;
+    if (p->format && is_object && item->child && !print_indent(p)) return 0;
+    return append(p, is_object ? "}" : "]", 1);
+}
+
+static int print_value(printbuf_t *p, const cJSON *item)
+{
+    switch (item->type & 0xFF) {
+        case cJSON_NULL: return append_str(p, "null");
+        case cJSON_False: return append_str(p, "false");
+        case cJSON_True: return append_str(p, "true");
+        case cJSON_Number: return print_number(p, item->valuedouble);
+        case cJSON_String: return print_string(p, item->valuestring ? item->valuestring : "");
+        case cJSON_Array: return print_container(p, item, 0);
+        case cJSON_Object: return print_container(p, item, 1);
+        default: return 0;
+    }
+}
+
+static char *print(const cJSON *item, int format)
+{
+    printbuf_t p = { .format = format };
+    if (item == NULL || !print_value(&p, item)) {
+        s_free(p.buf);
+        return NULL;
+    }
+    // Shrink to fit, like cJSON does after printing
+    char *out = s_malloc(p.len + 1);
+    if (out != NULL) {
+        memcpy(out, p.buf, p.len + 1);
+    }
+    s_free(p.buf);
+    return out;
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    return print(item, 1);
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item)
+{
+    return print(item, 0);
+}
+
+// ==================== Parsing ====================
+
+static const char *skip_ws(const char *s)
+{
+    while (s && *s && isspace((unsigned char)*s)) {
+        s++;
+    }
+    return s;
+}
+
+static const char *parse_value(cJSON *item, const char *s);
+
+static const char *parse_string_raw(char **out, const char *s)
+{
+    if (*s != '"') {
+        return NULL;
+    }
+    const char *end = ++s;
+    size_t len = 0;
+    while (*end && *end != '"') {
+        if (*end == '\\' && end[1]) {
+            end++;
+        }
+        end++;
+        len++;
+    }
+    if (*end != '"') {
+        return NULL;
+    }
+    char *str = s_malloc(len + 1);
+    if (str == NULL) {
+        return NULL;
+    }
+    char *w = str;
+    while (s < end) {
+        if (*s == '\\') {
+            s++;
+            switch (*s) {
+                case 'n': *w++ = '\n'; break;
+                case 't': *w++ = '\t'; break;
+                case 'r': *w++ = '\r'; break;
+                case 'b': *w++ = '\b'; break;
+                case 'f': *w++ = '\f'; break;
+                case 'u': *w++ = '?'; s += (s[1] && s[2] && s[3] && s[4]) ? 4 : 0; break;
+                default: *w++ = *s; break;
+            }
+            s++;
+        } else {
+            *w++ = *s++;
+        }
+    }
+    *w = '\0';
+    *out = str;
+    return end + 1;
+}
+
+static const char *parse_container(cJSON *item, const char *s, int is_object)
+{
+    item->type = is_object ? cJSON_Object : cJSON_Array;
+    s = skip_ws(s + 1);
+    if (*s == (is_object ? '}' : ']')) {
+        return s + 1;
+    }
+    for (;;) {
+        cJSON *child = new_item(cJSON_Invalid);
+        if (child == NULL) {
+            return NULL;
+        }
+        cJSON_AddItemToArray(item, child);
+        if (is_object) {
+            s = parse_string_raw(&child->string, skip_ws(s));
+            if (s == NULL) return NULL;
+            s = skip_ws(s);
+            if (*s != ':') return NULL;
+            s++;
+        }
+        s = parse_value(child, skip_ws(s));
+        if (s == NULL) return NULL;
+        s = skip_ws(s);
+        if (*s == ',') {
+            s++;
+            continue;
+        }
+        if (*s == (is_object ? '}' : ']')) {
+            return s + 1;
+        }
+        return NULL;
+    }
+}
+
+static const char *parse_value(cJSON *item, const char *s)
+{
+    if (s == NULL || *s == '\0') {
+        return NULL;
+    }
+    if (strncmp(s, "null", 4) == 0) {
+        item->type = cJSON_NULL;
+        return s + 4;
+    }
+    if (strncmp(s, "false", 5) == 0) {
+        item->type = cJSON_False;
+        return s + 5;
+    }
+    if (strncmp(s, "true", 4) == 0) {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        return s + 4;
+    }
+    if (*s == '"') {
+        item->type = cJSON_String;
+        return parse_string_raw(&item->valuestring, s);
+    }
+    if (*s == '-' || isdigit((unsigned char)*s)) {
+        char *end;
+        double d = strtod(s, &end);
+        item->type = cJSON_Number;
+        item->valuedouble = d;
+        item->valueint = (d >= 2147483647.0) ? 2147483647 :
+                         (d <= -2147483648.0) ? (-2147483647 - 1) : (int)d;
+        return end;
+    }
+    if (*s == '{') {
+        return parse_container(item, s, 1);
+    }
+    if (*s == '[') {
+        return parse_container(item, s, 0);
+    }
+    return NULL;
+}
+
+cJSON *cJSON_Parse(const char *value)
+{
+    cJSON *item = new_item(cJSON_Invalid);
+    if (item == NULL) {
+        return NULL;
+    }
+    if (parse_value(item, skip_ws(value)) == NULL) {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
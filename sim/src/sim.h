@@ -0,0 +1,153 @@
+/*
+ * Host Simulation - Harness Interface
+ *
+ * The firmware sources are compiled unchanged against the stand-in headers
+ * in sim/include. This header is what the harness (sim_main.c) uses to
+ * drive the virtual clock, the sensors and the network, and to observe the
+ * light output.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+
+#define SIM_US_PER_TICK     (1000000ULL / configTICK_RATE_HZ)
+#define SIM_US_PER_SEC      1000000ULL
+#define SIM_FOREVER         UINT64_MAX
+
+// ==================== Virtual Clock / Scheduler ====================
+
+uint64_t sim_now_us(void);
+
+// Run tasks and timers until the virtual clock reaches end_us, or until
+// a timer callback calls sim_stop()
+void sim_run_until(uint64_t end_us);
+void sim_stop(void);
+
+// True while a simulated task (as opposed to a timer or ISR) is running
+bool sim_in_task(void);
+
+// Block the running task for exactly us of virtual time
+void sim_task_sleep_us(uint64_t us);
+
+// Block the running task until sim_signal(obj) or the absolute deadline
+// (SIM_FOREVER for none). Returns true if signalled.
+bool sim_block_on(const void *obj, uint64_t deadline_us);
+void sim_signal(const void *obj);
+
+// One-shot timers that run on the scheduler loop (not in a task)
+typedef void (*sim_timer_cb_t)(void *arg);
+typedef struct sim_timer sim_timer_t;
+
+sim_timer_t *sim_timer_new(sim_timer_cb_t cb, void *arg);
+void sim_timer_arm(sim_timer_t *timer, uint64_t at_us);
+void sim_timer_disarm(sim_timer_t *timer);
+bool sim_timer_armed(const sim_timer_t *timer);
+
+typedef struct {
+    uint64_t busy_spins;    // Zero-tick yields that had to be force-advanced
+    uint64_t wakeups;       // Virtual instants at which a task or esp_timer callback ran
+} sim_sched_stats_t;
+
+const sim_sched_stats_t *sim_sched_stats(void);
+void sim_report_tasks(FILE *out, double wall_s);
+
+// ==================== Hardware ====================
+
+void sim_gpio_set_input(int pin, int level);
+// Scenario light level per channel; each conversion adds uniform noise
+// of +/- lsb on top
+void sim_adc_set_raw(int channel, int raw);
+int sim_adc_clean(int channel);
+void sim_adc_set_noise(int lsb, uint32_t seed);
+
+typedef struct {
+    uint64_t conversions;
+    uint64_t frames;        // Continuous-mode frames handed to the firmware
+    uint64_t blocked_us;    // Virtual time tasks waited for DMA frames
+} sim_adc_stats_t;
+
+const sim_adc_stats_t *sim_adc_stats(void);
+
+typedef struct {
+    uint64_t writes;
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint64_t erases;                // Sector erases
+    uint32_t max_sector_erases;     // Wear of the most and least erased sector
+    uint32_t min_sector_erases;
+} sim_flash_stats_t;
+
+const sim_flash_stats_t *sim_flash_stats(void);
+
+// Called whenever the aggregated light output (relay GPIO high or any
+// lit WS2812 pixel) changes
+typedef void (*sim_output_cb_t)(bool on, uint64_t at_us);
+void sim_set_output_observer(sim_output_cb_t cb);
+bool sim_light_output(void);
+
+typedef struct {
+    uint64_t refreshes;
+    uint64_t pixels_set;
+    uint64_t wire_us;       // Total modelled WS2812 transmit time
+    uint64_t busy_us;       // Time at least one strip was transmitting
+} sim_strip_stats_t;
+
+const sim_strip_stats_t *sim_strip_stats(void);
+
+// ==================== Network ====================
+
+typedef struct {
+    bool up;                        // Access point / server reachable
+    bool server_stalled;            // WiFi up, but requests go unanswered
+    uint64_t wifi_assoc_us;         // Association + DHCP time
+    uint64_t tcp_connect_us;
+    uint64_t tls_full_us;           // Full TLS handshake incl. cert verify
+    uint64_t tls_resume_us;         // Abbreviated handshake with a session ticket
+    uint64_t rtt_us;                // Request/response round trip
+    uint64_t server_idle_close_us;  // Server keep-alive timeout
+    const char *reject_content_type;    // Bodies of this type get 415
+    int server_error;               // Non-zero: every request gets this status
+} sim_net_model_t;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t tcp_connects;
+    uint64_t tls_full;
+    uint64_t tls_resumed;
+    uint64_t bytes_sent;
+    uint64_t blocked_us;            // Virtual time callers spent in perform()
+    uint64_t max_blocked_us;
+} sim_net_stats_t;
+
+sim_net_model_t *sim_net_model(void);
+const sim_net_stats_t *sim_net_stats(void);
+void sim_net_set_up(bool up);
+
+// Called with every request body the simulated server accepts (status
+// 200), or answers with model->server_error
+typedef void (*sim_net_sink_t)(int status, const char *content_type, const char *body, size_t len);
+void sim_net_set_sink(sim_net_sink_t sink);
+
+// Inject an HTTP request into the registered esp_http_server handlers.
+// Returns the HTTP status code (404 when nothing matches); the response
+// body is copied into resp (NUL-terminated, truncated to cap).
+int sim_httpd_request(int method, const char *uri, const char *body,
+                      char *resp, size_t cap);
+
+// Open a WebSocket client on uri (the handshake runs its GET handler).
+// Returns the client's socket fd, or -1 if nothing accepts it.
+int sim_httpd_ws_connect(const char *uri);
+void sim_httpd_ws_close(int fd);
+
+// Called with every frame the firmware sends to a simulated WebSocket client
+typedef void (*sim_ws_observer_t)(int fd, const char *data, size_t len, uint64_t at_us);
+void sim_httpd_set_ws_observer(sim_ws_observer_t cb);
+
+// ==================== Firmware Entry ====================
+
+void app_main(void);
@@ -0,0 +1,887 @@
+/*
+ * Host Simulation - GPIO, ADC, LED Strip, NVS, Heap and Logging Stand-ins
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "driver/gpio.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "led_strip.h"
+#include "sim.h"
+
+// WS2812 timing: 24 bits at 1.25 us plus the >50 us latch
+#define WS2812_US_PER_PIXEL     30
+#define WS2812_RESET_US         50
+
+// ==================== Logging / Errors / Time ====================
+
+esp_log_level_t sim_log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    sim_log_level = level;
+}
+
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list args;
+    printf("%c (%llu) %s: ", letters[level],
+           (unsigned long long)(sim_now_us() / 1000), tag);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    putchar('\n');
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_HTTP_CONNECT: return "ESP_ERR_HTTP_CONNECT";
+        case ESP_ERR_HTTP_FETCH_HEADER: return "ESP_ERR_HTTP_FETCH_HEADER";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// Without SNTP the board's clock starts at zero on boot, so the firmware's
+// "timestamp" field is really uptime. Overriding the libc symbols keeps
+// that behaviour and keeps runs repeatable.
+int gettimeofday(struct timeval *restrict tv, void *restrict tz)
+{
+    (void)tz;
+    uint64_t now = sim_now_us();
+    tv->tv_sec = (time_t)(now / SIM_US_PER_SEC);
+    tv->tv_usec = (suseconds_t)(now % SIM_US_PER_SEC);
+    return 0;
+}
+
+time_t time(time_t *tloc)
+{
+    time_t now = (time_t)(sim_now_us() / SIM_US_PER_SEC);
+    if (tloc != NULL) {
+        *tloc = now;
+    }
+    return now;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200 * 1024;
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "sim: esp_restart() called at %llu us\n",
+            (unsigned long long)sim_now_us());
+    exit(2);
+}
+
+// ==================== NVS ====================
+
+#define SIM_NVS_MAX_NS      4
+#define SIM_NVS_MAX_KEYS    32
+
+struct sim_nvs_entry {
+    nvs_handle_t handle;
+    char key[16];
+    uint32_t value;
+};
+
+static struct sim_nvs_entry s_nvs[SIM_NVS_MAX_KEYS];
+static int s_nvs_count = 0;
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    s_nvs_count = 0;
+    return ESP_OK;
+}
+
+// Handles are namespace indices + 1
+static const char *s_nvs_ns[SIM_NVS_MAX_NS];
+static int s_nvs_ns_count = 0;
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)open_mode;
+    if (namespace_name == NULL || out_handle == NULL || strlen(namespace_name) > 15) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < s_nvs_ns_count; i++) {
+        if (strcmp(s_nvs_ns[i], namespace_name) == 0) {
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    if (s_nvs_ns_count == SIM_NVS_MAX_NS) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    s_nvs_ns[s_nvs_ns_count++] = strdup(namespace_name);
+    *out_handle = (nvs_handle_t)s_nvs_ns_count;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return (handle >= 1 && handle <= (nvs_handle_t)s_nvs_ns_count) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static struct sim_nvs_entry *nvs_find(nvs_handle_t handle, const char *key, bool create)
+{
+    for (int i = 0; i < s_nvs_count; i++) {
+        if (s_nvs[i].handle == handle && strcmp(s_nvs[i].key, key) == 0) {
+            return &s_nvs[i];
+        }
+    }
+    if (!create || s_nvs_count == SIM_NVS_MAX_KEYS || strlen(key) > 15) {
+        return NULL;
+    }
+    struct sim_nvs_entry *e = &s_nvs[s_nvs_count++];
+    e->handle = handle;
+    strcpy(e->key, key);
+    return e;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    struct sim_nvs_entry *e = nvs_find(handle, key, false);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = e->value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    struct sim_nvs_entry *e = nvs_find(handle, key, true);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NO_FREE_PAGES;
+    }
+    e->value = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value)
+{
+    uint32_t v;
+    esp_err_t err = nvs_get_u32(handle, key, &v);
+    if (err == ESP_OK) {
+        *out_value = (uint16_t)v;
+    }
+    return err;
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value)
+{
+    return nvs_set_u32(handle, key, value);
+}
+
+// ==================== Heap ====================
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? NULL : malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? NULL : calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    // An ESP32 without PSRAM after WiFi and the HTTP server are up
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : 160 * 1024;
+}
+
+// ==================== Flash Partition ====================
+
+#define SIM_SPOOL_SIZE          (128 * 1024)
+#define SIM_FLASH_SECTOR        4096
+
+static const esp_partition_t s_spool_part = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = 0x40,
+    .address = 0x310000,
+    .size = SIM_SPOOL_SIZE,
+    .erase_size = SIM_FLASH_SECTOR,
+    .label = "spool",
+};
+static uint8_t *s_spool_mem;
+static uint32_t s_sector_erases[SIM_SPOOL_SIZE / SIM_FLASH_SECTOR];
+static sim_flash_stats_t s_flash_stats;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    (void)subtype;
+    if (type != ESP_PARTITION_TYPE_DATA || label == NULL || strcmp(label, s_spool_part.label) != 0) {
+        return NULL;
+    }
+    if (s_spool_mem == NULL) {
+        // A fresh chip reads erased
+        s_spool_mem = malloc(SIM_SPOOL_SIZE);
+        memset(s_spool_mem, 0xFF, SIM_SPOOL_SIZE);
+    }
+    return &s_spool_part;
+}
+
+static bool flash_range_ok(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    return partition == &s_spool_part && offset <= partition->size && size <= partition->size - offset;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (!flash_range_ok(partition, src_offset, size)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, s_spool_mem + src_offset, size);
+    s_flash_stats.bytes_read += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (!flash_range_ok(partition, dst_offset, size)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *p = src;
+    for (size_t i = 0; i < size; i++) {
+        s_spool_mem[dst_offset + i] &= p[i];
+    }
+    s_flash_stats.writes++;
+    s_flash_stats.bytes_written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (!flash_range_ok(partition, offset, size) || offset % SIM_FLASH_SECTOR || size % SIM_FLASH_SECTOR) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s_spool_mem + offset, 0xFF, size);
+    for (size_t sector = offset / SIM_FLASH_SECTOR; sector < (offset + size) / SIM_FLASH_SECTOR; sector++) {
+        s_sector_erases[sector]++;
+        s_flash_stats.erases++;
+        if (s_sector_erases[sector] > s_flash_stats.max_sector_erases) {
+            s_flash_stats.max_sector_erases = s_sector_erases[sector];
+        }
+    }
+    return ESP_OK;
+}
+
+const sim_flash_stats_t *sim_flash_stats(void)
+{
+    uint32_t min = UINT32_MAX;
+    for (size_t i = 0; i < SIM_SPOOL_SIZE / SIM_FLASH_SECTOR; i++) {
+        if (s_sector_erases[i] < min) {
+            min = s_sector_erases[i];
+        }
+    }
+    s_flash_stats.min_sector_erases = min;
+    return &s_flash_stats;
+}
+
+// ==================== Light Output Observation ====================
+
+static sim_output_cb_t s_output_cb = NULL;
+static bool s_output_on = false;
+
+static bool gpio_outputs_high(void);
+static bool strips_lit(void);
+
+static void output_update(void)
+{
+    bool on = gpio_outputs_high() || strips_lit();
+    if (on != s_output_on) {
+        s_output_on = on;
+        if (s_output_cb != NULL) {
+            s_output_cb(on, sim_now_us());
+        }
+    }
+}
+
+void sim_set_output_observer(sim_output_cb_t cb)
+{
+    s_output_cb = cb;
+}
+
+bool sim_light_output(void)
+{
+    return s_output_on;
+}
+
+// ==================== GPIO ====================
+
+typedef struct {
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    int level;
+    gpio_isr_t isr;
+    void *isr_arg;
+} sim_gpio_t;
+
+static sim_gpio_t s_gpio[GPIO_NUM_MAX];
+static bool s_isr_service = false;
+
+static bool valid_pin(int pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX;
+}
+
+static bool gpio_outputs_high(void)
+{
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if ((s_gpio[i].mode & GPIO_MODE_OUTPUT) && s_gpio[i].level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (pGPIOConfig->pin_bit_mask & (1ULL << i)) {
+            s_gpio[i].mode = pGPIOConfig->mode;
+            s_gpio[i].intr_type = pGPIOConfig->intr_type;
+            s_gpio[i].intr_enabled = pGPIOConfig->intr_type != GPIO_INTR_DISABLE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].level = level ? 1 : 0;
+    output_update();
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return valid_pin(gpio_num) ? s_gpio[gpio_num].level : 0;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].isr = isr_handler;
+    s_gpio[gpio_num].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio[gpio_num].isr = NULL;
+    return ESP_OK;
+}
+
+void sim_gpio_set_input(int pin, int level)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    sim_gpio_t *g = &s_gpio[pin];
+    int prev = g->level;
+    g->level = level ? 1 : 0;
+    if (prev == g->level || g->isr == NULL || !g->intr_enabled) {
+        return;
+    }
+    bool fire = g->intr_type == GPIO_INTR_ANYEDGE ||
+                (g->intr_type == GPIO_INTR_POSEDGE && g->level) ||
+                (g->intr_type == GPIO_INTR_NEGEDGE && !g->level) ||
+                (g->intr_type == GPIO_INTR_HIGH_LEVEL && g->level) ||
+                (g->intr_type == GPIO_INTR_LOW_LEVEL && !g->level);
+    if (fire) {
+        g->isr(g->isr_arg);
+    }
+}
+
+// ==================== ADC ====================
+
+static int s_adc_raw[SOC_ADC_MAX_CHANNEL_NUM];
+static int s_adc_noise = 0;
+static uint32_t s_adc_rng = 1;
+static sim_adc_stats_t s_adc_stats;
+
+// One conversion: the scenario's level plus this conversion's noise
+static int adc_convert(int channel)
+{
+    int raw = s_adc_raw[channel];
+    if (s_adc_noise > 0) {
+        // xorshift32
+        s_adc_rng ^= s_adc_rng << 13;
+        s_adc_rng ^= s_adc_rng >> 17;
+        s_adc_rng ^= s_adc_rng << 5;
+        raw += (int)(s_adc_rng % (uint32_t)(2 * s_adc_noise + 1)) - s_adc_noise;
+    }
+    s_adc_stats.conversions++;
+    return (raw < 0) ? 0 : (raw > 4095) ? 4095 : raw;
+}
+
+void sim_adc_set_raw(int channel, int raw)
+{
+    if (channel >= 0 && channel < SOC_ADC_MAX_CHANNEL_NUM) {
+        s_adc_raw[channel] = (raw < 0) ? 0 : (raw > 4095) ? 4095 : raw;
+    }
+}
+
+int sim_adc_clean(int channel)
+{
+    return (channel >= 0 && channel < SOC_ADC_MAX_CHANNEL_NUM) ? s_adc_raw[channel] : -1;
+}
+
+void sim_adc_set_noise(int lsb, uint32_t seed)
+{
+    s_adc_noise = lsb;
+    s_adc_rng = seed ? seed : 1;
+}
+
+const sim_adc_stats_t *sim_adc_stats(void)
+{
+    return &s_adc_stats;
+}
+
+// Continuous (DMA) mode
+
+struct adc_continuous_ctx_t {
+    adc_continuous_handle_cfg_t cfg;
+    adc_continuous_config_t conv;
+    adc_digi_pattern_config_t pattern;
+    bool configured;
+    bool started;
+    uint64_t produced_until_us;     // Conversions up to here are in the pool
+};
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *hdl_config,
+                                    adc_continuous_handle_t *ret_handle)
+{
+    if (hdl_config == NULL || ret_handle == NULL || hdl_config->conv_frame_size == 0 ||
+        hdl_config->conv_frame_size % SOC_ADC_DIGI_RESULT_BYTES != 0 ||
+        hdl_config->max_store_buf_size < hdl_config->conv_frame_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct adc_continuous_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (ctx == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->cfg = *hdl_config;
+    *ret_handle = ctx;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t *config)
+{
+    if (handle == NULL || config == NULL || config->pattern_num != 1 || config->adc_pattern == NULL ||
+        config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+        config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH ||
+        config->adc_pattern[0].channel >= SOC_ADC_MAX_CHANNEL_NUM) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->conv = *config;
+    handle->pattern = config->adc_pattern[0];
+    handle->conv.adc_pattern = &handle->pattern;
+    handle->configured = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle)
+{
+    if (handle == NULL || !handle->configured || handle->started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->started = true;
+    handle->produced_until_us = sim_now_us();
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle)
+{
+    if (handle == NULL || !handle->started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t *buf, uint32_t length_max,
+                              uint32_t *out_length, uint32_t timeout_ms)
+{
+    if (handle == NULL || buf == NULL || out_length == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_length = 0;
+    if (!handle->started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t bytes = (length_max < handle->cfg.conv_frame_size) ? length_max : handle->cfg.conv_frame_size;
+    uint32_t n = bytes / SOC_ADC_DIGI_RESULT_BYTES;
+    if (n == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Wait for the DMA to fill the frame
+    uint64_t ready = handle->produced_until_us +
+                     ((uint64_t)n * SIM_US_PER_SEC + handle->conv.sample_freq_hz - 1) / handle->conv.sample_freq_hz;
+    uint64_t now = sim_now_us();
+    if (ready > now) {
+        if (timeout_ms != ADC_MAX_DELAY && (ready - now) > (uint64_t)timeout_ms * 1000) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (sim_in_task()) {
+            s_adc_stats.blocked_us += ready - now;
+            sim_task_sleep_us(ready - now);
+        }
+    }
+    handle->produced_until_us = ready;
+
+    adc_digi_output_data_t *out = (adc_digi_output_data_t *)buf;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i].val = 0;
+        out[i].type1.channel = handle->pattern.channel;
+        out[i].type1.data = adc_convert(handle->pattern.channel);
+    }
+    s_adc_stats.frames++;
+    *out_length = n * SOC_ADC_DIGI_RESULT_BYTES;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_flush_pool(adc_continuous_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->produced_until_us = sim_now_us();
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle)
+{
+    if (handle == NULL || handle->started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+// Calibration (ESP32 line fitting with the default Vref)
+
+struct adc_cali_scheme_t {
+    uint32_t coeff_a;       // mV per raw count, Q16
+    uint32_t coeff_b;       // mV offset
+};
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config,
+                                              adc_cali_handle_t *ret_handle)
+{
+    static const uint32_t atten_scale[4] = { 57431, 76236, 105481, 196602 };
+    static const uint32_t atten_offset[4] = { 75, 78, 107, 142 };
+
+    if (config == NULL || ret_handle == NULL || config->atten > ADC_ATTEN_DB_12 ||
+        (config->bitwidth != ADC_BITWIDTH_DEFAULT && config->bitwidth != ADC_BITWIDTH_12)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct adc_cali_scheme_t *cali = calloc(1, sizeof(*cali));
+    if (cali == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    cali->coeff_a = config->default_vref * atten_scale[config->atten] / 4096;
+    cali->coeff_b = atten_offset[config->atten];
+    *ret_handle = cali;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle)
+{
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage)
+{
+    if (handle == NULL || voltage == NULL || raw < 0 || raw > 4095) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *voltage = (int)((((uint64_t)handle->coeff_a * raw) + 32768) / 65536 + handle->coeff_b);
+    return ESP_OK;
+}
+
+// ==================== LED Strip ====================
+
+#define SIM_MAX_STRIPS  8
+
+struct led_strip_t {
+    uint32_t max_leds;
+    uint8_t *pixels;    // RGB triplets
+    bool lit;
+    bool lit_pending;   // What the strip shows once the transfer ends
+    uint64_t done_us;   // End of the transfer in flight, 0 when idle
+};
+
+static struct led_strip_t s_strips[SIM_MAX_STRIPS];
+static int s_strip_count = 0;
+static sim_strip_stats_t s_strip_stats;
+static uint64_t s_wire_until = 0;  // End of the last transfer on any strip
+
+static bool strips_lit(void)
+{
+    for (int i = 0; i < s_strip_count; i++) {
+        if (s_strips[i].lit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const sim_strip_stats_t *sim_strip_stats(void)
+{
+    return &s_strip_stats;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config,
+                                   const led_strip_rmt_config_t *rmt_config,
+                                   led_strip_handle_t *ret_strip)
+{
+    (void)rmt_config;
+    if (led_config == NULL || ret_strip == NULL || led_config->max_leds == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Reuse the slot of a deleted strip (the firmware re-creates its
+    // strip when the length changes)
+    struct led_strip_t *strip = NULL;
+    for (int i = 0; i < s_strip_count && strip == NULL; i++) {
+        if (s_strips[i].max_leds == 0) {
+            strip = &s_strips[i];
+        }
+    }
+    if (strip == NULL) {
+        if (s_strip_count >= SIM_MAX_STRIPS) {
+            return ESP_ERR_NO_MEM;
+        }
+        strip = &s_strips[s_strip_count++];
+    }
+    strip->max_leds = led_config->max_leds;
+    strip->pixels = calloc(led_config->max_leds, 3);
+    strip->lit = false;
+    strip->done_us = 0;
+    if (strip->pixels == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    *ret_strip = strip;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index,
+                              uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (strip == NULL || index >= strip->max_leds) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t *px = &strip->pixels[index * 3];
+    px[0] = (uint8_t)red;
+    px[1] = (uint8_t)green;
+    px[2] = (uint8_t)blue;
+    s_strip_stats.pixels_set++;
+    return ESP_OK;
+}
+
+// Start sending the pixel buffer; returns the wire time. Outside a task
+// (e.g. an injected HTTP request) the transfer is treated as
+// instantaneous.
+static uint64_t strip_start(led_strip_handle_t strip)
+{
+    uint64_t wire_us = (uint64_t)strip->max_leds * WS2812_US_PER_PIXEL + WS2812_RESET_US;
+    bool lit = false;
+    for (uint32_t i = 0; i < strip->max_leds * 3 && !lit; i++) {
+        lit = strip->pixels[i] != 0;
+    }
+    s_strip_stats.refreshes++;
+    s_strip_stats.wire_us += wire_us;
+    strip->lit_pending = lit;
+    if (!sim_in_task()) {
+        return 0;
+    }
+    uint64_t now = sim_now_us();
+    uint64_t end = now + wire_us;
+    if (end > s_wire_until) {
+        s_strip_stats.busy_us += end - ((s_wire_until > now) ? s_wire_until : now);
+        s_wire_until = end;
+    }
+    strip->done_us = end;
+    return wire_us;
+}
+
+static void strip_finish(led_strip_handle_t strip)
+{
+    strip->done_us = 0;
+    strip->lit = strip->lit_pending;
+    output_update();
+}
+
+static void strip_transmit(led_strip_handle_t strip)
+{
+    uint64_t wire_us = strip_start(strip);
+    if (wire_us > 0) {
+        sim_task_sleep_us(wire_us);
+    }
+    strip_finish(strip);
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    if (strip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strip->done_us != 0) {
+        return ESP_ERR_INVALID_STATE;   // A transfer is still in flight
+    }
+    strip_transmit(strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip)
+{
+    if (strip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strip->done_us != 0) {
+        return ESP_ERR_INVALID_STATE;   // A transfer is still in flight
+    }
+    if (strip_start(strip) == 0) {
+        strip_finish(strip);
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh_wait_done(led_strip_handle_t strip)
+{
+    if (strip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strip->done_us == 0) {
+        return ESP_OK;
+    }
+    uint64_t now = sim_now_us();
+    if (strip->done_us > now) {
+        sim_task_sleep_us(strip->done_us - now);
+    }
+    strip_finish(strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    if (strip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_strip_refresh_wait_done(strip);
+    memset(strip->pixels, 0, strip->max_leds * 3);
+    strip_transmit(strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    if (strip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    free(strip->pixels);
+    strip->pixels = NULL;
+    strip->max_leds = 0;
+    strip->lit = false;
+    strip->done_us = 0;
+    output_update();
+    return ESP_OK;
+}
@@ -0,0 +1,1016 @@
+/*
+ * Host Simulation - Harness Entry Point
+ *
+ * Boots one firmware build (app_main runs as the "main" task, exactly as
+ * on the board), drives its PIR input and light sensor from a synthetic
+ * day/night scenario or from recorded telemetry (-r), and reports how the
+ * control loop behaved and what it cost in host CPU time.
+ *
+ * Per-build wiring is passed in by the Makefile:
+ *   SIM_FIRMWARE_NAME     Name printed in the report
+ *   SIM_PIR_ACTIVE_LOW    PIR reads LOW on motion (smartlight.c)
+ *   SIM_DARK_IS_LOW_ADC   Darkness gives a LOW reading (smartlightrgb.c)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "sim.h"
+#include "sim_replay.h"
+#include "cJSON.h"
+#include "telemetry_cbor.h"
+
+#ifndef SIM_FIRMWARE_NAME
+#define SIM_FIRMWARE_NAME       "firmware"
+#endif
+#ifndef SIM_PIR_ACTIVE_LOW
+#define SIM_PIR_ACTIVE_LOW      0
+#endif
+#ifndef SIM_DARK_IS_LOW_ADC
+#define SIM_DARK_IS_LOW_ADC     0
+#endif
+
+#define SIM_PIR_PIN             13
+#define SIM_ADC_CHANNEL         6
+
+// Raw readings of the bundled LDR divider (strong light = low ADC)
+#define SCENE_RAW_BRIGHT        1400
+#define SCENE_RAW_DARK          3300
+#define SCENE_ADC_PERIOD_US     (100 * 1000ULL)
+
+// Reading error probe: GET /status every period, skipped for a while
+// after the scene's light level steps by SCENE_LIGHT_STEP or more
+#define PROBE_PERIOD_US         (10 * SIM_US_PER_SEC)
+#define PROBE_SETTLE_US         (3 * SIM_US_PER_SEC)
+#define SCENE_LIGHT_STEP        16
+
+// The WS2812 build serves an index.html embedded by the IDF build system
+__asm__(".section .rodata\n"
+        ".global _binary_index_html_start\n"
+        "_binary_index_html_start:\n"
+        ".ascii \"<!DOCTYPE html><html><body>sim</body></html>\"\n"
+        ".global _binary_index_html_end\n"
+        "_binary_index_html_end:\n"
+        ".text\n");
+
+// ==================== Options ====================
+
+static struct {
+    double hours;
+    bool hours_set;
+    uint32_t seed;
+    int noise;
+    const char *replay_path;
+    bool interpolate;
+    double keep_alive_s;
+    double outage_at_h;
+    double outage_h;
+    double stall_at_h;
+    double stall_h;
+    double error_at_h;
+    double error_h;
+    int error_status;
+    bool ctrl_probe;
+    int effect;
+    int strip_length;
+    int zones;
+    bool drag;
+    int render_fps;
+    const char *reject_type;
+    const char *dump_path;
+} s_opt = {
+    .hours = 24.0,
+    .seed = 1,
+    .noise = 40,
+    .effect = -1,
+    .error_status = 503,
+};
+
+// ==================== Deterministic PRNG ====================
+
+static uint64_t s_rng;
+
+static uint32_t rng_next(void)
+{
+    // xorshift64*
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 2685821657736338717ULL) >> 32);
+}
+
+static double rng_unit(void)
+{
+    return rng_next() / 4294967296.0;
+}
+
+static uint64_t rng_exp_us(double mean_s)
+{
+    double u = rng_unit();
+    if (u < 1e-12) {
+        u = 1e-12;
+    }
+    return (uint64_t)(-mean_s * log(u) * SIM_US_PER_SEC);
+}
+
+// ==================== Sensor Inputs ====================
+
+static bool s_motion = false;
+
+static void track_motion(bool motion);
+
+static void scene_set_motion(bool motion)
+{
+    if (motion != s_motion) {
+        track_motion(motion);
+    }
+    s_motion = motion;
+    int level = motion ? 1 : 0;
+    sim_gpio_set_input(SIM_PIR_PIN, SIM_PIR_ACTIVE_LOW ? !level : level);
+}
+
+static uint64_t s_light_step_us = 0;
+
+// raw is in the LDR's native sense (dark = high); mirrored for builds
+// wired the other way round. Conversion noise is added by the ADC model.
+static void scene_set_light_raw(int raw)
+{
+    int prev = sim_adc_clean(SIM_ADC_CHANNEL);
+    int adc = SIM_DARK_IS_LOW_ADC ? 4095 - raw : raw;
+    if (abs(adc - prev) >= SCENE_LIGHT_STEP) {
+        s_light_step_us = sim_now_us();
+    }
+    sim_adc_set_raw(SIM_ADC_CHANNEL, adc);
+}
+
+// ==================== Synthetic Day Scenario ====================
+
+static sim_timer_t *s_adc_timer;
+static sim_timer_t *s_pir_timer;
+
+// Ambient light: dark at night, bright by day, linear ramps at dawn/dusk
+static int scene_ambient_raw(uint64_t t_us)
+{
+    double h = (double)(t_us % (24ULL * 3600 * SIM_US_PER_SEC)) / (3600.0 * SIM_US_PER_SEC);
+    double dark;
+    if (h < 6.0 || h >= 19.0) {
+        dark = 1.0;
+    } else if (h < 7.0) {
+        dark = 7.0 - h;
+    } else if (h >= 18.0) {
+        dark = h - 18.0;
+    } else {
+        dark = 0.0;
+    }
+    return SCENE_RAW_BRIGHT + (int)(dark * (SCENE_RAW_DARK - SCENE_RAW_BRIGHT));
+}
+
+static void scene_adc_tick(void *arg)
+{
+    (void)arg;
+    uint64_t now = sim_now_us();
+    scene_set_light_raw(scene_ambient_raw(now));
+    sim_timer_arm(s_adc_timer, now + SCENE_ADC_PERIOD_US);
+}
+
+// Occupancy: visits arrive more often by day, each holds the PIR output
+// high for 20 s to 5 min
+static void scene_pir_tick(void *arg)
+{
+    (void)arg;
+    uint64_t now = sim_now_us();
+    if (s_motion) {
+        scene_set_motion(false);
+        double h = (double)(now % (24ULL * 3600 * SIM_US_PER_SEC)) / (3600.0 * SIM_US_PER_SEC);
+        double mean_gap_s = (h >= 7.0 && h < 23.0) ? 15 * 60.0 : 60 * 60.0;
+        sim_timer_arm(s_pir_timer, now + rng_exp_us(mean_gap_s));
+    } else {
+        scene_set_motion(true);
+        uint64_t hold_us = (20 + rng_next() % 281) * SIM_US_PER_SEC;
+        sim_timer_arm(s_pir_timer, now + hold_us);
+    }
+}
+
+static void scene_synthetic_start(void)
+{
+    s_adc_timer = sim_timer_new(scene_adc_tick, NULL);
+    s_pir_timer = sim_timer_new(scene_pir_tick, NULL);
+    scene_set_motion(false);
+    scene_adc_tick(NULL);
+    sim_timer_arm(s_pir_timer, rng_exp_us(5 * 60.0));
+}
+
+// ==================== Output Metrics ====================
+
+typedef struct {
+    uint64_t *v;
+    size_t n;
+    size_t cap;
+} samples_t;
+
+static samples_t s_latency;
+static uint64_t s_pending_since = 0;
+static bool s_pending = false;
+static uint64_t s_missed = 0;
+static uint64_t s_turn_on = 0;
+static uint64_t s_turn_off = 0;
+static uint64_t s_on_since = 0;
+static uint64_t s_on_total_us = 0;
+
+// Reported light reading against the noise-free ADC level, in LSB
+static samples_t s_read_error;
+static sim_timer_t *s_probe_timer;
+
+// Status push client on /ws: what it received, and how long after an
+// output change the frame carrying the new light state arrived
+static int s_ws_fd = -1;
+static uint64_t s_ws_frames = 0;
+static uint64_t s_ws_bytes = 0;
+static samples_t s_push_latency;
+static bool s_push_pending = false;
+static uint64_t s_push_pending_since = 0;
+static size_t s_status_bytes = 0;      // Last full /status body, for the polling comparison
+
+// Telemetry the simulated server received: POST bodies, records by
+// "event" (a body without "records" is one snapshot), bytes per POST.
+// -T keeps the CBOR bodies, back to back, for the host decoder.
+static FILE *s_tele_dump;
+static uint64_t s_tele_cbor_posts = 0;
+static uint64_t s_tele_posts = 0;
+static uint64_t s_tele_bytes = 0;
+static uint64_t s_tele_records = 0;
+static uint64_t s_tele_events[4];       // sample, motion, light, mode
+
+// Replay only: output changes measured from the sample that caused them
+static sim_replay_t *s_replay;
+static samples_t s_decision;
+static bool s_decision_open = false;
+static uint64_t s_decision_since = 0;
+static uint64_t s_chatter = 0;
+static uint64_t s_records = 0;
+static uint64_t s_agree = 0;
+
+static void samples_push(samples_t *s, uint64_t v)
+{
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 256;
+        s->v = realloc(s->v, s->cap * sizeof(*s->v));
+    }
+    s->v[s->n++] = v;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const samples_t *s, double p)
+{
+    if (s->n == 0) {
+        return 0;
+    }
+    size_t idx = (size_t)(p * (s->n - 1) + 0.5);
+    return s->v[idx];
+}
+
+static void on_output(bool on, uint64_t at_us)
+{
+    if (s_ws_fd >= 0) {
+        s_push_pending = true;
+        s_push_pending_since = at_us;
+    }
+    if (s_replay != NULL) {
+        // The first change after a sample is its decision; any further
+        // change before the next sample is noise-driven chatter
+        if (s_decision_open) {
+            samples_push(&s_decision, at_us - s_decision_since);
+            s_decision_open = false;
+        } else {
+            s_chatter++;
+        }
+    }
+    if (on) {
+        s_turn_on++;
+        s_on_since = at_us;
+        if (s_pending) {
+            samples_push(&s_latency, at_us - s_pending_since);
+            s_pending = false;
+        }
+    } else {
+        s_turn_off++;
+        s_on_total_us += at_us - s_on_since;
+    }
+}
+
+// Track motion onsets that find the light off; the latency sample is the
+// time until the output comes on. Onsets the firmware ignores (daylight)
+// simply never complete.
+static void track_motion(bool motion)
+{
+    if (motion && !sim_light_output()) {
+        s_pending = true;
+        s_pending_since = sim_now_us();
+    } else if (!motion && s_pending) {
+        s_pending = false;
+        s_missed++;
+    }
+}
+
+// ==================== Replay Scenario ====================
+
+// Samples are laid out on the serverTimestamp timeline; the light reading
+// is held (or interpolated with -i) and re-sampled with noise every
+// SCENE_ADC_PERIOD_US, motion is held until the next sample.
+
+static sim_replay_record_t s_rec_cur;
+static sim_replay_record_t s_rec_next;
+static bool s_have_next = false;
+static long long s_replay_t0;
+static sim_timer_t *s_replay_timer;
+static sim_timer_t *s_replay_adc_timer;
+
+static uint64_t replay_time_us(const sim_replay_record_t *rec)
+{
+    return (uint64_t)(rec->server_ts - s_replay_t0) * SIM_US_PER_SEC;
+}
+
+static int replay_light_raw(uint64_t now)
+{
+    if (!s_opt.interpolate || !s_have_next) {
+        return s_rec_cur.light_value;
+    }
+    uint64_t t0 = replay_time_us(&s_rec_cur);
+    uint64_t t1 = replay_time_us(&s_rec_next);
+    if (t1 <= t0 || now >= t1) {
+        return s_rec_next.light_value;
+    }
+    double f = (double)(now - t0) / (double)(t1 - t0);
+    return s_rec_cur.light_value + (int)(f * (s_rec_next.light_value - s_rec_cur.light_value));
+}
+
+static void replay_adc_tick(void *arg)
+{
+    (void)arg;
+    uint64_t now = sim_now_us();
+    scene_set_light_raw(replay_light_raw(now));
+    sim_timer_arm(s_replay_adc_timer, now + SCENE_ADC_PERIOD_US);
+}
+
+static void replay_apply(void *arg)
+{
+    (void)arg;
+    uint64_t now = sim_now_us();
+
+    if (s_records > 0) {
+        // Score the outgoing sample against what the device did back then
+        if (sim_light_output() == s_rec_cur.light_on) {
+            s_agree++;
+        }
+    }
+    if (!s_have_next) {
+        sim_stop();
+        return;
+    }
+
+    s_rec_cur = s_rec_next;
+    s_have_next = sim_replay_next(s_replay, &s_rec_next);
+    s_records++;
+    s_decision_open = true;
+    s_decision_since = now;
+
+    scene_set_light_raw(replay_light_raw(now));
+    scene_set_motion(s_rec_cur.motion);
+
+    // serverTimestamp has 1 s resolution; spread arrivals across that second
+    // so they don't all line up with the firmware's loop period. After the
+    // last sample, hold it for one more minute so its decision is scored too
+    sim_timer_arm(s_replay_timer,
+                  s_have_next ? replay_time_us(&s_rec_next) + rng_next() % SIM_US_PER_SEC
+                              : now + 60 * SIM_US_PER_SEC);
+}
+
+static bool scene_replay_start(const char *path)
+{
+    s_replay = sim_replay_open(path);
+    if (s_replay == NULL || !sim_replay_next(s_replay, &s_rec_next)) {
+        fprintf(stderr, "cannot read samples from %s\n", path);
+        return false;
+    }
+    s_have_next = true;
+    s_replay_t0 = s_rec_next.server_ts;
+    s_replay_timer = sim_timer_new(replay_apply, NULL);
+    s_replay_adc_timer = sim_timer_new(replay_adc_tick, NULL);
+    scene_set_motion(false);
+    replay_apply(NULL);
+    sim_timer_arm(s_replay_adc_timer, SCENE_ADC_PERIOD_US);
+    return true;
+}
+
+// ==================== Reading Probe ====================
+
+static void probe_tick(void *arg)
+{
+    (void)arg;
+    uint64_t now = sim_now_us();
+    char resp[1024];
+    if (s_ws_fd < 0) {
+        s_ws_fd = sim_httpd_ws_connect("/ws");
+    }
+    if (now - s_light_step_us >= PROBE_SETTLE_US &&
+        sim_httpd_request(HTTP_GET, "/status", NULL, resp, sizeof(resp)) == 200) {
+        s_status_bytes = strlen(resp);
+        // "lightValue" on the relay builds, "light_value" on the WS2812 one
+        const char *v = strstr(resp, "\"lightValue\":");
+        if (v == NULL) {
+            v = strstr(resp, "\"light_value\":");
+        }
+        if (v != NULL) {
+            int reading = atoi(strchr(v, ':') + 1);
+            samples_push(&s_read_error, (uint64_t)abs(reading - sim_adc_clean(SIM_ADC_CHANNEL)));
+        }
+        // -C: re-send the current brightness, a no-op that still has to go
+        // through the WS2812 build's control queue (see max_late_ms)
+        const char *b = strstr(resp, "\"brightness\":");
+        if (s_opt.ctrl_probe && b != NULL) {
+            char cmd[64];
+            snprintf(cmd, sizeof(cmd), "{\"action\":\"set_brightness\",\"brightness\":%d}",
+                     atoi(strchr(b, ':') + 1));
+            sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+        }
+    }
+    sim_timer_arm(s_probe_timer, now + PROBE_PERIOD_US);
+}
+
+static void on_ws_frame(int fd, const char *data, size_t len, uint64_t at_us)
+{
+    (void)fd;
+    char frame[512];
+    snprintf(frame, sizeof(frame), "%.*s", (int)len, data);
+    s_ws_frames++;
+    s_ws_bytes += len;
+    // "lightOn" on the relay builds, "light_on" on the WS2812 one
+    if (s_push_pending && (strstr(frame, "\"lightOn\"") != NULL ||
+                           strstr(frame, "\"light_on\"") != NULL)) {
+        samples_push(&s_push_latency, at_us - s_push_pending_since);
+        s_push_pending = false;
+    }
+}
+
+// -X: every record in a body the server answered with an error, and
+// every record it accepted, as t_ms * 4 + kind. A refused record must
+// arrive later; one that never does was deleted from the ring or spool.
+static samples_t s_refused_keys;
+static samples_t s_accepted_keys;
+static uint64_t s_refused_posts = 0;
+static size_t s_tele_lost = 0;
+
+static void tele_record(bool accepted, int64_t t_ms, int kind)
+{
+    if (accepted && kind >= 0 && kind < 4) {
+        s_tele_records++;
+        s_tele_events[kind]++;
+    }
+    if (s_opt.error_h > 0) {
+        samples_push(accepted ? &s_accepted_keys : &s_refused_keys, (uint64_t)t_ms * 4 + (uint64_t)kind);
+    }
+}
+
+static void on_telemetry(int status, const char *content_type, const char *body, size_t len)
+{
+    bool accepted = (status == 200);
+    if (accepted) {
+        s_tele_posts++;
+        s_tele_bytes += len;
+    } else {
+        s_refused_posts++;
+    }
+    if (content_type != NULL && strcmp(content_type, TELEMETRY_CBOR_CONTENT_TYPE) == 0) {
+        if (accepted && s_tele_dump != NULL) {
+            fwrite(body, 1, len, s_tele_dump);
+        }
+        telemetry_cbor_info_t info;
+        telemetry_record_t rec[TELEMETRY_RING_SIZE];
+        if (telemetry_cbor_decode((const uint8_t *)body, len, &info, rec, TELEMETRY_RING_SIZE) == len) {
+            s_tele_cbor_posts += accepted;
+            for (uint32_t i = 0; i < info.count && i < TELEMETRY_RING_SIZE; i++) {
+                tele_record(accepted, rec[i].t_ms, rec[i].kind);
+            }
+        }
+        return;
+    }
+    cJSON *root = cJSON_Parse(body);
+    if (root == NULL) {
+        return;
+    }
+    cJSON *records = cJSON_GetObjectItem(root, "records");
+    if (!cJSON_IsArray(records)) {
+        tele_record(accepted, 0, 0);
+    } else {
+        static const char *const kinds[] = { "sample", "motion", "light", "mode" };
+        for (cJSON *rec = records->child; rec != NULL; rec = rec->next) {
+            cJSON *event = cJSON_GetObjectItem(rec, "event");
+            int kind = -1;
+            for (int k = 0; k < 4; k++) {
+                if (cJSON_IsString(event) && strcmp(event->valuestring, kinds[k]) == 0) {
+                    kind = k;
+                }
+            }
+            cJSON *ts = cJSON_GetObjectItem(rec, "timestamp");
+            cJSON *ms = cJSON_GetObjectItem(rec, "ms");
+            int64_t t_ms = (cJSON_IsNumber(ts) ? (int64_t)ts->valuedouble * 1000 : 0) +
+                           (cJSON_IsNumber(ms) ? ms->valueint : 0);
+            if (kind < 0) {
+                s_tele_records += accepted;
+            } else {
+                tele_record(accepted, t_ms, kind);
+            }
+        }
+    }
+    cJSON_Delete(root);
+}
+
+// Refused records (counted once however often they were sent) that the
+// server never accepted afterwards
+static size_t tele_refused_lost(size_t *refused)
+{
+    qsort(s_refused_keys.v, s_refused_keys.n, sizeof(*s_refused_keys.v), cmp_u64);
+    qsort(s_accepted_keys.v, s_accepted_keys.n, sizeof(*s_accepted_keys.v), cmp_u64);
+    size_t lost = 0, a = 0;
+    *refused = 0;
+    for (size_t i = 0; i < s_refused_keys.n; i++) {
+        if (i > 0 && s_refused_keys.v[i] == s_refused_keys.v[i - 1]) {
+            continue;
+        }
+        (*refused)++;
+        while (a < s_accepted_keys.n && s_accepted_keys.v[a] < s_refused_keys.v[i]) {
+            a++;
+        }
+        if (a == s_accepted_keys.n || s_accepted_keys.v[a] != s_refused_keys.v[i]) {
+            lost++;
+        }
+    }
+    return lost;
+}
+
+// ==================== Network Outage ====================
+
+// -O: the access point (and with it the server) goes away for a while
+static sim_timer_t *s_outage_timer;
+
+static void outage_tick(void *arg)
+{
+    (void)arg;
+    bool up = !sim_net_model()->up;
+    sim_net_set_up(up);
+    if (!up) {
+        sim_timer_arm(s_outage_timer, sim_now_us() + (uint64_t)(s_opt.outage_h * 3600.0 * SIM_US_PER_SEC));
+    }
+}
+
+// -S: WiFi stays associated but the server stops answering, so every
+// request runs into its timeout instead of being skipped as offline
+static sim_timer_t *s_stall_timer;
+
+static void stall_tick(void *arg)
+{
+    (void)arg;
+    sim_net_model_t *model = sim_net_model();
+    model->server_stalled = !model->server_stalled;
+    if (model->server_stalled) {
+        sim_timer_arm(s_stall_timer, sim_now_us() + (uint64_t)(s_opt.stall_h * 3600.0 * SIM_US_PER_SEC));
+    }
+}
+
+// -X: WiFi and server stay up, but the server (or a proxy in front of
+// it) answers every request with an error status
+static sim_timer_t *s_error_timer;
+
+static void error_tick(void *arg)
+{
+    (void)arg;
+    sim_net_model_t *model = sim_net_model();
+    model->server_error = model->server_error ? 0 : s_opt.error_status;
+    if (model->server_error) {
+        sim_timer_arm(s_error_timer, sim_now_us() + (uint64_t)(s_opt.error_h * 3600.0 * SIM_US_PER_SEC));
+    }
+}
+
+// -N: set the WS2812 strip length over /control (stored in NVS)
+static void strip_length_set(void *arg)
+{
+    (void)arg;
+    char cmd[64], resp[256];
+    snprintf(cmd, sizeof(cmd), "{\"action\":\"set_strip_length\",\"length\":%d}", s_opt.strip_length);
+    sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+}
+
+// -R: set the WS2812 frame rate over /control (stored in NVS)
+static void render_fps_set(void *arg)
+{
+    (void)arg;
+    char cmd[64], resp[256];
+    snprintf(cmd, sizeof(cmd), "{\"action\":\"set_fps\",\"fps\":%d}", s_opt.render_fps);
+    sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+}
+
+// -Z: split the WS2812 strip into equal segments, cycling through the
+// animated effects and a few colours
+static void zones_set(void *arg)
+{
+    (void)arg;
+    static const int effects[] = { 2, 3, 4 };
+    int len = (s_opt.strip_length > 0) ? s_opt.strip_length : 5;
+    int per = len / s_opt.zones;
+    for (int i = 0; i < s_opt.zones && per > 0; i++) {
+        char cmd[192], resp[256];
+        snprintf(cmd, sizeof(cmd),
+                 "{\"action\":\"set_segment\",\"name\":\"zone%d\",\"start\":%d,\"length\":%d,"
+                 "\"effect\":%d,\"r\":%d,\"g\":%d,\"b\":%d,\"speed\":%d}",
+                 i, i * per, per, effects[i % 3], (i * 97) & 0xFF, (i * 53 + 80) & 0xFF,
+                 (255 - i * 31) & 0xFF, 20 + (i * 10) % 70);
+        sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+    }
+}
+
+// -E: switch the WS2812 build to manual mode and start an effect, so the
+// render loop animates for the whole run
+static void effect_start(void *arg)
+{
+    (void)arg;
+    char cmd[64], resp[256];
+    sim_httpd_request(HTTP_POST, "/control", "{\"action\":\"toggle_mode\"}", resp, sizeof(resp));
+    snprintf(cmd, sizeof(cmd), "{\"action\":\"set_effect\",\"effect\":%d}", s_opt.effect);
+    sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+}
+
+// -F: turn the light on by hand, then drag a brightness slider from 1 to
+// 100 % with a command every DRAG_STEP_US, as a phone UI sends them.
+// The renderer should fade to each new target, not send a frame per
+// command.
+#define DRAG_AT_US      (6 * SIM_US_PER_SEC)
+#define DRAG_STEP_US    10000
+#define DRAG_STEPS      100
+
+static struct {
+    sim_timer_t *timer;
+    int step;
+    uint64_t refreshes_before;
+    uint64_t refreshes_after;
+    int brightness_after;
+} s_drag;
+
+static void drag_tick(void *arg)
+{
+    (void)arg;
+    char cmd[64], resp[2048];
+    if (s_drag.step == 0) {
+        sim_httpd_request(HTTP_POST, "/control", "{\"action\":\"toggle_mode\"}", resp, sizeof(resp));
+        sim_httpd_request(HTTP_POST, "/control", "{\"action\":\"on\"}", resp, sizeof(resp));
+    } else if (s_drag.step == 1) {
+        s_drag.refreshes_before = sim_strip_stats()->refreshes;
+    }
+    if (s_drag.step >= 1 && s_drag.step <= DRAG_STEPS) {
+        snprintf(cmd, sizeof(cmd), "{\"action\":\"set_brightness\",\"brightness\":%d}", s_drag.step);
+        sim_httpd_request(HTTP_POST, "/control", cmd, resp, sizeof(resp));
+    }
+    if (s_drag.step == DRAG_STEPS + 1) {
+        // Well after the last fade has ended
+        s_drag.refreshes_after = sim_strip_stats()->refreshes;
+        if (sim_httpd_request(HTTP_GET, "/status", NULL, resp, sizeof(resp)) == 200) {
+            cJSON *st = cJSON_Parse(resp);
+            cJSON *b = cJSON_GetObjectItem(st, "brightness");
+            s_drag.brightness_after = cJSON_IsNumber(b) ? b->valueint : -1;
+            cJSON_Delete(st);
+        }
+        return;
+    }
+    s_drag.step++;
+    sim_timer_arm(s_drag.timer, sim_now_us() + ((s_drag.step == DRAG_STEPS + 1) ? 2 * SIM_US_PER_SEC : DRAG_STEP_US));
+}
+
+// ==================== Report ====================
+
+static void print_latency(const char *label, samples_t *s)
+{
+    qsort(s->v, s->n, sizeof(*s->v), cmp_u64);
+    double sum = 0;
+    for (size_t i = 0; i < s->n; i++) {
+        sum += s->v[i];
+    }
+    printf("%s: n=%zu avg=%.1f ms p50=%.1f ms p95=%.1f ms max=%.1f ms\n",
+           label, s->n, s->n ? sum / s->n / 1000.0 : 0.0,
+           percentile(s, 0.50) / 1000.0,
+           percentile(s, 0.95) / 1000.0,
+           percentile(s, 1.0) / 1000.0);
+}
+
+static void print_histogram(const samples_t *s)
+{
+    static const uint64_t edges_ms[] = { 1, 10, 50, 100, 200, 500, 1000 };
+    const size_t n_edges = sizeof(edges_ms) / sizeof(edges_ms[0]);
+    size_t counts[sizeof(edges_ms) / sizeof(edges_ms[0]) + 1] = { 0 };
+
+    for (size_t i = 0; i < s->n; i++) {
+        size_t b = 0;
+        while (b < n_edges && s->v[i] >= edges_ms[b] * 1000) {
+            b++;
+        }
+        counts[b]++;
+    }
+    for (size_t b = 0; b <= n_edges; b++) {
+        char label[32];
+        if (b == 0) {
+            snprintf(label, sizeof(label), "< %llu ms", (unsigned long long)edges_ms[0]);
+        } else if (b == n_edges) {
+            snprintf(label, sizeof(label), ">= %llu ms", (unsigned long long)edges_ms[b - 1]);
+        } else {
+            snprintf(label, sizeof(label), "%llu-%llu ms",
+                     (unsigned long long)edges_ms[b - 1], (unsigned long long)edges_ms[b]);
+        }
+        int bar = s->n ? (int)(40 * counts[b] / s->n) : 0;
+        printf("  %12s %6zu %.*s\n", label, counts[b], bar,
+               "########################################");
+    }
+}
+
+static void report(double wall_s)
+{
+    uint64_t end = sim_now_us();
+    double sim_s = end / 1e6;
+    if (sim_light_output()) {
+        s_on_total_us += end - s_on_since;
+    }
+    printf("=== %s (host simulation) ===\n", SIM_FIRMWARE_NAME);
+    printf("simulated %.2f h in %.3f s wall (%.0fx real time), seed %u\n",
+           sim_s / 3600.0, wall_s, wall_s > 0 ? sim_s / wall_s : 0.0, s_opt.seed);
+    printf("light output: %llu on / %llu off (%.2f toggles/h), on-time %.2f h (%.1f%%)\n",
+           (unsigned long long)s_turn_on, (unsigned long long)s_turn_off,
+           (s_turn_on + s_turn_off) / (sim_s / 3600.0),
+           s_on_total_us / 3.6e9, 100.0 * s_on_total_us / (double)end);
+    if (s_replay != NULL) {
+        // Recorded samples are minutes apart, so motion->light latency is
+        // meaningless here; score each sample's decision instead
+        printf("replay: %llu samples, output matched recorded lightOn for %.1f%%\n",
+               (unsigned long long)s_records,
+               s_records ? 100.0 * s_agree / s_records : 0.0);
+        print_latency("decision latency (sample->output)", &s_decision);
+        printf("chatter toggles between samples: %llu\n", (unsigned long long)s_chatter);
+    } else {
+        printf("motion onsets ignored (light stayed off): %llu\n", (unsigned long long)s_missed);
+        print_latency("motion->light latency", &s_latency);
+        print_histogram(&s_latency);
+    }
+
+    qsort(s_read_error.v, s_read_error.n, sizeof(*s_read_error.v), cmp_u64);
+    double err_sum = 0;
+    for (size_t i = 0; i < s_read_error.n; i++) {
+        err_sum += s_read_error.v[i];
+    }
+    const sim_adc_stats_t *adc = sim_adc_stats();
+    printf("light reading error (noise +/-%d): n=%zu avg=%.1f p95=%llu max=%llu LSB; "
+           "adc %.0f conversions/s, %llu DMA frames, %.1f s waited\n",
+           s_opt.noise, s_read_error.n, s_read_error.n ? err_sum / s_read_error.n : 0.0,
+           (unsigned long long)percentile(&s_read_error, 0.95),
+           (unsigned long long)percentile(&s_read_error, 1.0),
+           adc->conversions / sim_s, (unsigned long long)adc->frames, adc->blocked_us / 1e6);
+
+    const sim_sched_stats_t *sched = sim_sched_stats();
+    printf("cpu wakeups: %llu (%.2f/s), busy-spin ticks: %llu\n",
+           (unsigned long long)sched->wakeups, sched->wakeups / sim_s,
+           (unsigned long long)sched->busy_spins);
+    sim_report_tasks(stdout, wall_s);
+
+    if (s_ws_fd >= 0) {
+        printf("status push (/ws): %llu frames (%.1f/h), %.0f payload bytes/h; "
+               "polling /status every 1 s: 3600 requests/h, %.0f payload bytes/h\n",
+               (unsigned long long)s_ws_frames, s_ws_frames / (sim_s / 3600.0),
+               s_ws_bytes / (sim_s / 3600.0), 3600.0 * s_status_bytes);
+        print_latency("output->push latency", &s_push_latency);
+    }
+
+    const sim_net_stats_t *net = sim_net_stats();
+    printf("network: %llu requests (%llu failed), %llu TCP connects, %llu full / %llu resumed TLS, "
+           "%llu bytes sent, max blocked %.1f ms\n",
+           (unsigned long long)net->requests, (unsigned long long)net->failures,
+           (unsigned long long)net->tcp_connects, (unsigned long long)net->tls_full,
+           (unsigned long long)net->tls_resumed, (unsigned long long)net->bytes_sent,
+           net->max_blocked_us / 1000.0);
+
+    if (s_tele_posts > 0) {
+        printf("telemetry: %llu POSTs (%llu CBOR), %llu records (%llu sample / %llu motion / %llu light / %llu mode), "
+               "%.0f bytes/record; light records %llu of %llu output changes\n",
+               (unsigned long long)s_tele_posts, (unsigned long long)s_tele_cbor_posts,
+               (unsigned long long)s_tele_records,
+               (unsigned long long)s_tele_events[0], (unsigned long long)s_tele_events[1],
+               (unsigned long long)s_tele_events[2], (unsigned long long)s_tele_events[3],
+               s_tele_records ? (double)s_tele_bytes / s_tele_records : 0.0,
+               (unsigned long long)s_tele_events[2], (unsigned long long)(s_turn_on + s_turn_off));
+    }
+    if (s_opt.error_h > 0) {
+        size_t refused;
+        s_tele_lost = tele_refused_lost(&refused);
+        printf("server errors (HTTP %d): %llu POSTs refused, %zu records in them, %zu never delivered\n",
+               s_opt.error_status, (unsigned long long)s_refused_posts, refused, s_tele_lost);
+    }
+
+    const sim_flash_stats_t *flash = sim_flash_stats();
+    if (flash->writes > 0) {
+        printf("spool flash: %llu writes (%llu bytes), %llu sector erases, wear %u..%u erases per sector\n",
+               (unsigned long long)flash->writes, (unsigned long long)flash->bytes_written,
+               (unsigned long long)flash->erases, flash->min_sector_erases, flash->max_sector_erases);
+    }
+
+    const sim_strip_stats_t *strip = sim_strip_stats();
+    if (strip->refreshes > 0) {
+        printf("led strip: %llu refreshes, %llu pixel writes, %.1f s on the wire (%.1f s busy)\n",
+               (unsigned long long)strip->refreshes, (unsigned long long)strip->pixels_set,
+               strip->wire_us / 1e6, strip->busy_us / 1e6);
+    }
+    if (strip->refreshes > 0) {
+        char status[512];
+        if (sim_httpd_request(HTTP_GET, "/status", NULL, status, sizeof(status)) == 200) {
+            cJSON *st = cJSON_Parse(status);
+            cJSON *ma = cJSON_GetObjectItem(st, "power_ma");
+            cJSON *budget = cJSON_GetObjectItem(st, "power_budget_ma");
+            if (cJSON_IsNumber(ma) && cJSON_IsNumber(budget)) {
+                printf("led power: %d mA at the end (budget %d mA)\n", ma->valueint, budget->valueint);
+            }
+            cJSON_Delete(st);
+        }
+    }
+    if (s_opt.drag) {
+        printf("slider drag: %d brightness commands %d ms apart, %llu strip refreshes, settled at %d%%\n",
+               DRAG_STEPS, DRAG_STEP_US / 1000,
+               (unsigned long long)(s_drag.refreshes_after - s_drag.refreshes_before),
+               s_drag.brightness_after);
+    }
+    char resp[2048];
+    if (s_opt.zones > 0 && sim_httpd_request(HTTP_GET, "/segments", NULL, resp, sizeof(resp)) == 200) {
+        printf("segments: %s\n", resp);
+    }
+    bool animated = s_opt.effect >= 0 || s_opt.zones > 0 || s_opt.drag || s_opt.render_fps > 0;
+    if (animated && sim_httpd_request(HTTP_GET, "/render", NULL, resp, sizeof(resp)) == 200) {
+        printf("render: %s\n", resp);
+    }
+}
+
+// ==================== Main ====================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-H hours] [-d days] [-s seed] [-n noise] [-r file [-i]] [-K secs] [-O at,hours]\n"
+            "          [-S at,hours] [-X at,hours[,status]] [-C] [-E effect] [-N leds] [-Z zones]\n"
+            "          [-F] [-R fps] [-U type] [-T file] [-v]\n"
+            "  -H hours   simulated duration (default 24, or the whole replay)\n"
+            "  -d days    simulated duration in days\n"
+            "  -s seed    scenario random seed (default 1)\n"
+            "  -n noise   +/- ADC noise in LSB (default 40)\n"
+            "  -r file    replay recorded samples (e.g. ../sensor_data_7days.json)\n"
+            "  -i         interpolate the light reading between replayed samples\n"
+            "  -K secs    server keep-alive timeout (default 75)\n"
+            "  -O at,hrs  network outage starting at hour at, lasting hrs\n"
+            "  -S at,hrs  server stops answering (WiFi stays up) at hour at, for hrs\n"
+            "  -X at,hrs[,status]  server answers every request with status (default 503)\n"
+            "             from hour at, for hrs; checks no refused record is lost\n"
+            "  -C         also send a no-op control command with every status probe\n"
+            "  -E effect  WS2812: manual mode with this effect running (2 breath, 3 rainbow, 4 cycle)\n"
+            "  -N leds    WS2812: set the strip length before the effect starts\n"
+            "  -Z zones   WS2812: split the strip into this many segments with their own effects\n"
+            "  -F         WS2812: drag a brightness slider (100 commands, 10 ms apart) at 6 s\n"
+            "  -R fps     WS2812: set the frame rate before the effect starts\n"
+            "  -U type    server answers 415 to bodies of this Content-Type\n"
+            "  -T file    save the CBOR telemetry bodies the server accepted\n"
+            "  -v         firmware INFO logs (repeat for DEBUG)\n",
+            prog);
+}
+
+static void main_task(void *arg)
+{
+    (void)arg;
+    app_main();
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "H:d:s:n:r:iK:O:S:X:CE:N:Z:FR:U:T:vh")) != -1) {
+        switch (opt) {
+            case 'H': s_opt.hours = atof(optarg); s_opt.hours_set = true; break;
+            case 'd': s_opt.hours = atof(optarg) * 24.0; s_opt.hours_set = true; break;
+            case 'r': s_opt.replay_path = optarg; break;
+            case 'i': s_opt.interpolate = true; break;
+            case 'K': s_opt.keep_alive_s = atof(optarg); break;
+            case 'O':
+                if (sscanf(optarg, "%lf,%lf", &s_opt.outage_at_h, &s_opt.outage_h) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'S':
+                if (sscanf(optarg, "%lf,%lf", &s_opt.stall_at_h, &s_opt.stall_h) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'X':
+                if (sscanf(optarg, "%lf,%lf,%d", &s_opt.error_at_h, &s_opt.error_h, &s_opt.error_status) < 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'C': s_opt.ctrl_probe = true; break;
+            case 'E': s_opt.effect = atoi(optarg); break;
+            case 'N': s_opt.strip_length = atoi(optarg); break;
+            case 'Z': s_opt.zones = atoi(optarg); break;
+            case 'F': s_opt.drag = true; break;
+            case 'R': s_opt.render_fps = atoi(optarg); break;
+            case 'U': s_opt.reject_type = optarg; break;
+            case 'T': s_opt.dump_path = optarg; break;
+            case 's': s_opt.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'n': s_opt.noise = atoi(optarg); break;
+            case 'v': sim_log_level = (sim_log_level < ESP_LOG_INFO) ? ESP_LOG_INFO : ESP_LOG_DEBUG; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    s_rng = 0x9E3779B97F4A7C15ULL ^ s_opt.seed;
+    sim_adc_set_noise(s_opt.noise, s_opt.seed * 2654435761u);
+    if (s_opt.keep_alive_s > 0) {
+        sim_net_model()->server_idle_close_us = (uint64_t)(s_opt.keep_alive_s * SIM_US_PER_SEC);
+    }
+
+    sim_net_model()->reject_content_type = s_opt.reject_type;
+    if (s_opt.dump_path != NULL && (s_tele_dump = fopen(s_opt.dump_path, "wb")) == NULL) {
+        perror(s_opt.dump_path);
+        return 1;
+    }
+
+    sim_set_output_observer(on_output);
+    sim_httpd_set_ws_observer(on_ws_frame);
+    sim_net_set_sink(on_telemetry);
+    if (s_opt.replay_path != NULL) {
+        if (!scene_replay_start(s_opt.replay_path)) {
+            return 1;
+        }
+        if (!s_opt.hours_set) {
+            s_opt.hours = 1e6;  // Until the recording ends
+        }
+    } else {
+        scene_synthetic_start();
+    }
+
+    if (s_opt.outage_h > 0) {
+        s_outage_timer = sim_timer_new(outage_tick, NULL);
+        sim_timer_arm(s_outage_timer, (uint64_t)(s_opt.outage_at_h * 3600.0 * SIM_US_PER_SEC));
+    }
+    if (s_opt.strip_length > 0) {
+        sim_timer_arm(sim_timer_new(strip_length_set, NULL), 4 * SIM_US_PER_SEC);
+    }
+    if (s_opt.render_fps > 0) {
+        sim_timer_arm(sim_timer_new(render_fps_set, NULL), 4200 * 1000);
+    }
+    if (s_opt.zones > 0) {
+        sim_timer_arm(sim_timer_new(zones_set, NULL), 4500 * 1000);
+    }
+    if (s_opt.effect >= 0) {
+        sim_timer_arm(sim_timer_new(effect_start, NULL), 5 * SIM_US_PER_SEC);
+    }
+    if (s_opt.drag) {
+        s_drag.timer = sim_timer_new(drag_tick, NULL);
+        sim_timer_arm(s_drag.timer, DRAG_AT_US);
+    }
+    if (s_opt.stall_h > 0) {
+        s_stall_timer = sim_timer_new(stall_tick, NULL);
+        sim_timer_arm(s_stall_timer, (uint64_t)(s_opt.stall_at_h * 3600.0 * SIM_US_PER_SEC));
+    }
+    if (s_opt.error_h > 0) {
+        s_error_timer = sim_timer_new(error_tick, NULL);
+        sim_timer_arm(s_error_timer, (uint64_t)(s_opt.error_at_h * 3600.0 * SIM_US_PER_SEC));
+    }
+
+    s_probe_timer = sim_timer_new(probe_tick, NULL);
+    sim_timer_arm(s_probe_timer, PROBE_PERIOD_US / 2);
+
+    // Same priority ESP-IDF gives the main task
+    xTaskCreate(main_task, "main", 3584, NULL, 1, NULL);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sim_run_until((uint64_t)(s_opt.hours * 3600.0 * SIM_US_PER_SEC));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    report((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    if (s_tele_dump != NULL) {
+        fclose(s_tele_dump);
+    }
+    return (s_tele_lost > 0) ? 1 : 0;
+}
@@ -0,0 +1,635 @@
+/*
+ * Host Simulation - WiFi, Event Loop, HTTP Server and HTTP Client Stand-ins
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_http_server.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "sim.h"
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+static sim_net_model_t s_model = {
+    .up = true,
+    .wifi_assoc_us = 1500 * 1000,
+    .tcp_connect_us = 40 * 1000,
+    .tls_full_us = 1200 * 1000,
+    .tls_resume_us = 150 * 1000,
+    .rtt_us = 60 * 1000,
+    .server_idle_close_us = 75 * SIM_US_PER_SEC,
+};
+static sim_net_stats_t s_stats;
+static sim_net_sink_t s_sink = NULL;
+
+sim_net_model_t *sim_net_model(void)
+{
+    return &s_model;
+}
+
+const sim_net_stats_t *sim_net_stats(void)
+{
+    return &s_stats;
+}
+
+void sim_net_set_sink(sim_net_sink_t sink)
+{
+    s_sink = sink;
+}
+
+// ==================== Event Loop ====================
+
+#define SIM_MAX_EVENT_HANDLERS  8
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} sim_event_handler_t;
+
+static sim_event_handler_t s_handlers[SIM_MAX_EVENT_HANDLERS];
+static int s_handler_count = 0;
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler,
+                                     void *event_handler_arg)
+{
+    if (s_handler_count >= SIM_MAX_EVENT_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_handlers[s_handler_count++] = (sim_event_handler_t) {
+        .base = event_base, .id = event_id,
+        .handler = event_handler, .arg = event_handler_arg,
+    };
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base,
+                                              int32_t event_id,
+                                              esp_event_handler_t event_handler,
+                                              void *event_handler_arg,
+                                              esp_event_handler_instance_t *instance)
+{
+    if (instance != NULL) {
+        *instance = &s_handlers[s_handler_count];
+    }
+    return esp_event_handler_register(event_base, event_id, event_handler, event_handler_arg);
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
+                         const void *event_data, size_t event_data_size,
+                         TickType_t ticks_to_wait)
+{
+    (void)event_data_size;
+    (void)ticks_to_wait;
+    for (int i = 0; i < s_handler_count; i++) {
+        sim_event_handler_t *h = &s_handlers[i];
+        if (h->base == event_base && (h->id == ESP_EVENT_ANY_ID || h->id == event_id)) {
+            h->handler(h->arg, event_base, event_id, (void *)event_data);
+        }
+    }
+    return ESP_OK;
+}
+
+// ==================== WiFi / Netif ====================
+
+static bool s_wifi_started = false;
+static bool s_wifi_connected = false;
+static sim_timer_t *s_assoc_timer = NULL;
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    static int dummy;
+    return (esp_netif_t *)&dummy;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    (void)interface;
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    (void)type;
+    return ESP_OK;
+}
+
+// Association finishes (or fails) after wifi_assoc_us, delivered from the
+// scheduler loop just like the WiFi task would deliver it on the board.
+static void assoc_done(void *arg)
+{
+    (void)arg;
+    if (s_model.up) {
+        ip_event_got_ip_t got_ip = {
+            .ip_info.ip.addr = 0x6401A8C0,     // 192.168.1.100
+        };
+        s_wifi_connected = true;
+        esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), 0);
+    } else {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL, 0, 0);
+    }
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    if (s_assoc_timer == NULL) {
+        s_assoc_timer = sim_timer_new(assoc_done, NULL);
+    }
+    s_wifi_started = true;
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    if (!s_wifi_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sim_timer_arm(s_assoc_timer, sim_now_us() + s_model.wifi_assoc_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    s_wifi_connected = false;
+    return ESP_OK;
+}
+
+void sim_net_set_up(bool up)
+{
+    if (s_model.up == up) {
+        return;
+    }
+    s_model.up = up;
+    if (!up && s_wifi_connected) {
+        s_wifi_connected = false;
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL, 0, 0);
+    }
+}
+
+// ==================== HTTP Server ====================
+
+#define SIM_MAX_URI_HANDLERS    16
+
+typedef struct {
+    httpd_uri_t uris[SIM_MAX_URI_HANDLERS];
+    int uri_count;
+    int max_uri_handlers;
+} sim_httpd_t;
+
+typedef struct {
+    const char *body;
+    size_t body_len;
+    size_t body_off;
+    char *resp;
+    size_t resp_cap;
+    size_t resp_len;
+    int status;
+    int fd;
+} sim_req_aux_t;
+
+static sim_httpd_t *s_httpd = NULL;
+
+// Plain requests share one fd; WebSocket clients get their own
+#define SIM_HTTP_FD         50
+#define SIM_WS_FD_BASE      60
+#define SIM_MAX_WS_CLIENTS  8
+
+static bool s_ws_open[SIM_MAX_WS_CLIENTS];
+static sim_ws_observer_t s_ws_observer = NULL;
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    sim_httpd_t *hd = calloc(1, sizeof(*hd));
+    if (hd == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    hd->max_uri_handlers = config->max_uri_handlers;
+    s_httpd = hd;
+    *handle = hd;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    if (handle == s_httpd) {
+        s_httpd = NULL;
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    sim_httpd_t *hd = handle;
+    // Same limit the real server enforces from httpd_config_t
+    if (hd->uri_count >= hd->max_uri_handlers || hd->uri_count >= SIM_MAX_URI_HANDLERS) {
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    hd->uris[hd->uri_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    sim_req_aux_t *aux = r->aux;
+    size_t left = aux->body_len - aux->body_off;
+    size_t n = (left < buf_len) ? left : buf_len;
+    memcpy(buf, aux->body + aux->body_off, n);
+    aux->body_off += n;
+    return (int)n;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    sim_req_aux_t *aux = r->aux;
+    aux->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    (void)r;
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    (void)r;
+    (void)field;
+    (void)value;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    sim_req_aux_t *aux = r->aux;
+    if (buf == NULL) {
+        return ESP_OK;
+    }
+    size_t len = (buf_len == HTTPD_RESP_USE_STRLEN) ? strlen(buf) : (size_t)buf_len;
+    if (aux->resp != NULL && aux->resp_cap > 0) {
+        size_t room = aux->resp_cap - 1 - aux->resp_len;
+        size_t n = (len < room) ? len : room;
+        memcpy(aux->resp + aux->resp_len, buf, n);
+        aux->resp_len += n;
+        aux->resp[aux->resp_len] = '\0';
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    return httpd_resp_send_chunk(r, buf, buf_len);
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *r)
+{
+    httpd_resp_set_status(r, "500 Internal Server Error");
+    return httpd_resp_send(r, "Internal Server Error", HTTPD_RESP_USE_STRLEN);
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    sim_req_aux_t *aux = r->aux;
+    return aux->fd;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    if (handle == NULL || handle != s_httpd) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    work(arg);
+    return ESP_OK;
+}
+
+static bool ws_fd_open(int fd)
+{
+    int slot = fd - SIM_WS_FD_BASE;
+    return slot >= 0 && slot < SIM_MAX_WS_CLIENTS && s_ws_open[slot];
+}
+
+// The harness never sends client frames, so there is nothing to receive
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    (void)req;
+    (void)max_len;
+    pkt->len = 0;
+    return ESP_FAIL;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (hd != s_httpd || !ws_fd_open(fd)) {
+        return ESP_FAIL;
+    }
+    if (s_ws_observer != NULL) {
+        s_ws_observer(fd, (const char *)frame->payload, frame->len, sim_now_us());
+    }
+    return ESP_OK;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    if (hd != s_httpd) {
+        return HTTPD_WS_CLIENT_INVALID;
+    }
+    if (ws_fd_open(fd)) {
+        return HTTPD_WS_CLIENT_WEBSOCKET;
+    }
+    return (fd == SIM_HTTP_FD) ? HTTPD_WS_CLIENT_HTTP : HTTPD_WS_CLIENT_INVALID;
+}
+
+void sim_httpd_set_ws_observer(sim_ws_observer_t cb)
+{
+    s_ws_observer = cb;
+}
+
+static int httpd_dispatch(int method, const char *uri, const char *body,
+                          char *resp, size_t cap, int fd, bool websocket)
+{
+    if (resp != NULL && cap > 0) {
+        resp[0] = '\0';
+    }
+    if (s_httpd == NULL) {
+        return 503;
+    }
+    size_t path_len = strcspn(uri, "?");
+    for (int i = 0; i < s_httpd->uri_count; i++) {
+        const httpd_uri_t *h = &s_httpd->uris[i];
+        if ((int)h->method != method || h->is_websocket != websocket ||
+            strlen(h->uri) != path_len || strncmp(h->uri, uri, path_len) != 0) {
+            continue;
+        }
+        sim_req_aux_t aux = {
+            .body = body ? body : "",
+            .body_len = body ? strlen(body) : 0,
+            .resp = resp,
+            .resp_cap = cap,
+            .status = 200,
+            .fd = fd,
+        };
+        httpd_req_t req = {
+            .handle = s_httpd,
+            .method = method,
+            .content_len = aux.body_len,
+            .aux = &aux,
+            .user_ctx = h->user_ctx,
+        };
+        snprintf((char *)req.uri, sizeof(req.uri), "%s", uri);
+        if (h->handler(&req) != ESP_OK && aux.status == 200) {
+            aux.status = 500;
+        }
+        return aux.status;
+    }
+    return 404;
+}
+
+int sim_httpd_request(int method, const char *uri, const char *body,
+                      char *resp, size_t cap)
+{
+    return httpd_dispatch(method, uri, body, resp, cap, SIM_HTTP_FD, false);
+}
+
+int sim_httpd_ws_connect(const char *uri)
+{
+    for (int slot = 0; slot < SIM_MAX_WS_CLIENTS; slot++) {
+        if (s_ws_open[slot]) {
+            continue;
+        }
+        // The handshake is complete by the time the handler sees the GET
+        int fd = SIM_WS_FD_BASE + slot;
+        s_ws_open[slot] = true;
+        if (httpd_dispatch(HTTP_GET, uri, NULL, NULL, 0, fd, true) != 200) {
+            s_ws_open[slot] = false;
+            return -1;
+        }
+        return fd;
+    }
+    return -1;
+}
+
+void sim_httpd_ws_close(int fd)
+{
+    if (ws_fd_open(fd)) {
+        s_ws_open[fd - SIM_WS_FD_BASE] = false;
+    }
+}
+
+// ==================== HTTP Client ====================
+
+struct esp_http_client {
+    esp_http_client_config_t config;
+    char content_type[64];
+    const char *post_data;
+    int post_len;
+    int status_code;
+    bool connected;
+    uint64_t last_used_us;
+    bool have_session;
+};
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    (void)conf;
+    return ESP_OK;
+}
+
+static bool client_is_tls(const esp_http_client_handle_t client)
+{
+    return client->config.transport_type == HTTP_TRANSPORT_OVER_SSL ||
+           (client->config.url != NULL && strncmp(client->config.url, "https:", 6) == 0);
+}
+
+static void client_event(esp_http_client_handle_t client, esp_http_client_event_id_t id)
+{
+    if (client->config.event_handler != NULL) {
+        esp_http_client_event_t evt = {
+            .event_id = id,
+            .client = client,
+            .user_data = client->config.user_data,
+        };
+        client->config.event_handler(&evt);
+    }
+}
+
+static void client_block(uint64_t us)
+{
+    if (sim_in_task()) {
+        sim_task_sleep_us(us);
+    }
+    s_stats.blocked_us += us;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (client == NULL) {
+        return NULL;
+    }
+    client->config = *config;
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    client->config.url = url;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->config.method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    if (strcasecmp(key, "Content-Type") == 0) {
+        snprintf(client->content_type, sizeof(client->content_type), "%s", value);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->post_data = data;
+    client->post_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    uint64_t start = sim_now_us();
+    uint64_t timeout_us = (uint64_t)(client->config.timeout_ms > 0 ? client->config.timeout_ms : 5000) * 1000;
+    esp_err_t err = ESP_OK;
+
+    s_stats.requests++;
+    if (client->connected && start - client->last_used_us >= s_model.server_idle_close_us) {
+        // Server already closed the idle keep-alive connection; the client
+        // only finds out when the request on the dead socket goes unanswered
+        client_block(s_model.rtt_us);
+        client->connected = false;
+        err = ESP_FAIL;
+        client_event(client, HTTP_EVENT_ERROR);
+        client_event(client, HTTP_EVENT_DISCONNECTED);
+    } else if (!s_model.up || s_model.server_stalled) {
+        client_block(timeout_us);
+        client->connected = false;
+        err = ESP_ERR_HTTP_CONNECT;
+        client_event(client, HTTP_EVENT_ERROR);
+    } else {
+        if (!client->connected) {
+            uint64_t connect_us = s_model.tcp_connect_us;
+            s_stats.tcp_connects++;
+            if (client_is_tls(client)) {
+                if (client->config.save_client_session && client->have_session) {
+                    connect_us += s_model.tls_resume_us;
+                    s_stats.tls_resumed++;
+                } else {
+                    connect_us += s_model.tls_full_us;
+                    s_stats.tls_full++;
+                }
+                client->have_session = true;
+            }
+            client_block(connect_us);
+            client->connected = true;
+            client_event(client, HTTP_EVENT_ON_CONNECTED);
+        }
+        client_event(client, HTTP_EVENT_HEADERS_SENT);
+        client_block(s_model.rtt_us);
+        s_stats.bytes_sent += (uint64_t)client->post_len;
+        if (s_model.reject_content_type != NULL &&
+            strcasecmp(client->content_type, s_model.reject_content_type) == 0) {
+            client->status_code = 415;
+        } else {
+            client->status_code = s_model.server_error ? s_model.server_error : 200;
+            if (s_sink != NULL && client->post_data != NULL) {
+                s_sink(client->status_code, client->content_type, client->post_data,
+                       (size_t)client->post_len);
+            }
+        }
+        client_event(client, HTTP_EVENT_ON_FINISH);
+    }
+
+    if (err != ESP_OK) {
+        s_stats.failures++;
+    }
+    client->last_used_us = sim_now_us();
+    uint64_t blocked = client->last_used_us - start;
+    if (blocked > s_stats.max_blocked_us) {
+        s_stats.max_blocked_us = blocked;
+    }
+    return err;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status_code;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    (void)client;
+    return 0;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client)
+{
+    (void)client;
+    return false;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->connected) {
+        client->connected = false;
+        client_event(client, HTTP_EVENT_DISCONNECTED);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    free(client);
+    return ESP_OK;
+}
@@ -0,0 +1,127 @@
+/*
+ * Host Simulation - Streaming Reader for Recorded Telemetry
+ *
+ * Reads the array that the server collects from push_sensor_data()
+ * (sensor_data_7days.json) one object at a time, so replay memory stays
+ * constant however long the recording is.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_replay.h"
+
+#define REPLAY_MAX_OBJECT   1024
+
+struct sim_replay {
+    FILE *fp;
+    char obj[REPLAY_MAX_OBJECT];
+};
+
+sim_replay_t *sim_replay_open(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    sim_replay_t *r = calloc(1, sizeof(*r));
+    if (r == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    r->fp = fp;
+    return r;
+}
+
+void sim_replay_close(sim_replay_t *r)
+{
+    if (r != NULL) {
+        fclose(r->fp);
+        free(r);
+    }
+}
+
+// Copy the next top-level-array element "{...}" into r->obj
+static bool next_object(sim_replay_t *r)
+{
+    int c;
+    size_t len = 0;
+    int depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+
+    while ((c = fgetc(r->fp)) != EOF) {
+        if (depth == 0) {
+            if (c != '{') {
+                continue;
+            }
+        } else if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        }
+
+        if (len < sizeof(r->obj) - 1) {
+            r->obj[len++] = (char)c;
+        }
+        if (!in_string) {
+            if (c == '{') {
+                depth++;
+            } else if (c == '}' && --depth == 0) {
+                r->obj[len] = '\0';
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Locate the value text of "key" inside a flat object
+static const char *field(const char *obj, const char *key)
+{
+    size_t key_len = strlen(key);
+    for (const char *p = strchr(obj, '"'); p != NULL; p = strchr(p + 1, '"')) {
+        if (strncmp(p + 1, key, key_len) == 0 && p[1 + key_len] == '"') {
+            p += key_len + 2;
+            while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == ':') {
+                p++;
+            }
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static long long field_int(const char *obj, const char *key, long long fallback)
+{
+    const char *v = field(obj, key);
+    return (v != NULL) ? strtoll(v, NULL, 10) : fallback;
+}
+
+static bool field_bool(const char *obj, const char *key)
+{
+    const char *v = field(obj, key);
+    return v != NULL && strncmp(v, "true", 4) == 0;
+}
+
+bool sim_replay_next(sim_replay_t *r, sim_replay_record_t *rec)
+{
+    while (next_object(r)) {
+        rec->server_ts = field_int(r->obj, "serverTimestamp", -1);
+        rec->device_ts = field_int(r->obj, "timestamp", -1);
+        rec->light_value = (int)field_int(r->obj, "lightValue", -1);
+        rec->motion = field_bool(r->obj, "motion");
+        rec->light_on = field_bool(r->obj, "lightOn");
+        rec->auto_mode = field_bool(r->obj, "autoMode");
+        if (rec->server_ts >= 0 && rec->light_value >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
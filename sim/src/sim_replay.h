@@ -0,0 +1,21 @@
+/*
+ * Host Simulation - Streaming Reader for Recorded Telemetry
+ */
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct {
+    long long server_ts;    // serverTimestamp (s), the replay timeline
+    long long device_ts;    // timestamp as sent by the device (uptime s)
+    int light_value;
+    bool motion;
+    bool light_on;
+    bool auto_mode;
+} sim_replay_record_t;
+
+typedef struct sim_replay sim_replay_t;
+
+sim_replay_t *sim_replay_open(const char *path);
+bool sim_replay_next(sim_replay_t *r, sim_replay_record_t *rec);
+void sim_replay_close(sim_replay_t *r);
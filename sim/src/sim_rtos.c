@@ -0,0 +1,809 @@
+/*
+ * Host Simulation - FreeRTOS / esp_timer Stand-ins on a Virtual Clock
+ *
+ * Every task is a ucontext coroutine. The scheduler always resumes the
+ * highest-priority ready task (round-robin among equals) and only moves
+ * the virtual clock forward once every task is blocked, jumping straight
+ * to the next task wake-up or timer expiry. Code therefore runs as if the
+ * CPU were infinitely fast, which is what makes a simulated day take
+ * seconds; the host CPU time spent inside each task is recorded so the
+ * real per-wakeup cost can still be benchmarked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+#define SIM_MAX_TASKS           16
+#define SIM_MAX_TIMERS          64
+#define SIM_TASK_STACK_BYTES    (256 * 1024)
+
+// A task yielding with vTaskDelay(0) keeps the CPU on the board until the
+// next tick interrupt. The simulator lets it spin this many times, then
+// charges it the rest of the tick so virtual time keeps moving.
+#define SIM_SPINS_PER_TICK      64
+
+struct sim_task {
+    ucontext_t ctx;
+    void *stack;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    UBaseType_t prio;
+    bool dead;
+    uint64_t wake_us;           // Ready once now >= wake_us
+    const void *wait_obj;       // Object blocked on, or NULL
+    bool signalled;
+    bool yielded;               // Last gave up the CPU via vTaskDelay(0)
+    uint32_t notify_count;      // Notification value
+    bool notify_pending;        // Notified since the last xTaskNotifyWait
+    uint64_t last_run_seq;
+    // Statistics
+    uint64_t runs;
+    uint64_t cpu_ns;
+    uint64_t max_run_ns;
+    uint64_t max_late_us;       // Worst pickup delay of a queue item or periodic wake
+};
+
+struct sim_timer {
+    sim_timer_cb_t cb;
+    void *arg;
+    bool armed;
+    uint64_t at_us;
+};
+
+static struct sim_task s_tasks[SIM_MAX_TASKS];
+static int s_task_count = 0;
+static struct sim_task *s_current = NULL;
+static ucontext_t s_sched_ctx;
+
+static struct sim_timer s_timers[SIM_MAX_TIMERS];
+static int s_timer_count = 0;
+
+static uint64_t s_now_us = 0;
+static uint64_t s_run_seq = 0;
+static uint64_t s_last_wakeup_us = UINT64_MAX;
+static int s_spins_at_now = 0;
+static bool s_stop = false;
+static sim_sched_stats_t s_stats;
+
+// esp_timer callbacks, reported like a task (the board runs them in one)
+static uint64_t s_esp_timer_runs = 0;
+static uint64_t s_esp_timer_ns = 0;
+static uint64_t s_esp_timer_max_ns = 0;
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t sim_now_us(void)
+{
+    return s_now_us;
+}
+
+bool sim_in_task(void)
+{
+    return s_current != NULL;
+}
+
+static struct sim_task *require_task(const char *what)
+{
+    if (s_current == NULL) {
+        fprintf(stderr, "sim: %s called outside a task\n", what);
+        abort();
+    }
+    return s_current;
+}
+
+// Return control to the scheduler; resumes when the task is picked again
+static void task_yield(void)
+{
+    struct sim_task *self = s_current;
+    swapcontext(&self->ctx, &s_sched_ctx);
+}
+
+static void task_trampoline(void)
+{
+    struct sim_task *self = s_current;
+    self->fn(self->arg);
+    // FreeRTOS tasks must not return; treat it like vTaskDelete(NULL)
+    self->dead = true;
+    task_yield();
+}
+
+// ==================== Blocking Primitives ====================
+
+void sim_task_sleep_us(uint64_t us)
+{
+    struct sim_task *self = require_task("sim_task_sleep_us");
+    self->wake_us = s_now_us + us;
+    task_yield();
+}
+
+bool sim_block_on(const void *obj, uint64_t deadline_us)
+{
+    struct sim_task *self = require_task("sim_block_on");
+    self->wait_obj = obj;
+    self->signalled = false;
+    self->wake_us = deadline_us;
+    task_yield();
+    self->wait_obj = NULL;
+    return self->signalled;
+}
+
+void sim_signal(const void *obj)
+{
+    for (int i = 0; i < s_task_count; i++) {
+        struct sim_task *t = &s_tasks[i];
+        if (!t->dead && t->wait_obj == obj) {
+            t->wait_obj = NULL;
+            t->signalled = true;
+            t->wake_us = s_now_us;
+        }
+    }
+}
+
+static uint64_t ticks_to_deadline(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return SIM_FOREVER;
+    }
+    return s_now_us + (uint64_t)ticks * SIM_US_PER_TICK;
+}
+
+// ==================== Timers ====================
+
+sim_timer_t *sim_timer_new(sim_timer_cb_t cb, void *arg)
+{
+    if (s_timer_count >= SIM_MAX_TIMERS) {
+        fprintf(stderr, "sim: out of timers\n");
+        abort();
+    }
+    sim_timer_t *t = &s_timers[s_timer_count++];
+    t->cb = cb;
+    t->arg = arg;
+    t->armed = false;
+    return t;
+}
+
+void sim_timer_arm(sim_timer_t *timer, uint64_t at_us)
+{
+    timer->at_us = (at_us < s_now_us) ? s_now_us : at_us;
+    timer->armed = true;
+}
+
+void sim_timer_disarm(sim_timer_t *timer)
+{
+    timer->armed = false;
+}
+
+bool sim_timer_armed(const sim_timer_t *timer)
+{
+    return timer->armed;
+}
+
+static sim_timer_t *next_timer(void)
+{
+    sim_timer_t *best = NULL;
+    for (int i = 0; i < s_timer_count; i++) {
+        sim_timer_t *t = &s_timers[i];
+        if (t->armed && (best == NULL || t->at_us < best->at_us)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void fire_due_timers(void)
+{
+    sim_timer_t *t;
+    while ((t = next_timer()) != NULL && t->at_us <= s_now_us) {
+        t->armed = false;
+        t->cb(t->arg);
+    }
+}
+
+// ==================== Scheduler ====================
+
+static struct sim_task *pick_ready_task(void)
+{
+    struct sim_task *best = NULL;
+    for (int i = 0; i < s_task_count; i++) {
+        struct sim_task *t = &s_tasks[i];
+        if (t->dead || t->wake_us > s_now_us) {
+            continue;
+        }
+        if (best == NULL || t->prio > best->prio ||
+            (t->prio == best->prio && t->last_run_seq < best->last_run_seq)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static uint64_t next_wake_us(void)
+{
+    uint64_t next = SIM_FOREVER;
+    for (int i = 0; i < s_task_count; i++) {
+        if (!s_tasks[i].dead && s_tasks[i].wake_us < next) {
+            next = s_tasks[i].wake_us;
+        }
+    }
+    sim_timer_t *t = next_timer();
+    if (t != NULL && t->at_us < next) {
+        next = t->at_us;
+    }
+    return next;
+}
+
+// Loop jitter: how long something the task was due to handle waited for it
+static void note_late(uint64_t due_us)
+{
+    if (s_current != NULL && s_now_us > due_us && s_now_us - due_us > s_current->max_late_us) {
+        s_current->max_late_us = s_now_us - due_us;
+    }
+}
+
+// The CPU is awake at this virtual instant (task run or esp_timer callback)
+static void note_wakeup(void)
+{
+    if (s_last_wakeup_us != s_now_us) {
+        s_last_wakeup_us = s_now_us;
+        s_spins_at_now = 0;
+        s_stats.wakeups++;
+    }
+}
+
+static void run_task(struct sim_task *t)
+{
+    note_wakeup();
+    t->last_run_seq = ++s_run_seq;
+    t->yielded = false;
+    s_current = t;
+    uint64_t start = host_ns();
+    swapcontext(&s_sched_ctx, &t->ctx);
+    uint64_t spent = host_ns() - start;
+    s_current = NULL;
+    t->runs++;
+    t->cpu_ns += spent;
+    if (spent > t->max_run_ns) {
+        t->max_run_ns = spent;
+    }
+}
+
+void sim_stop(void)
+{
+    s_stop = true;
+}
+
+void sim_run_until(uint64_t end_us)
+{
+    s_stop = false;
+    for (;;) {
+        fire_due_timers();
+        if (s_stop) {
+            return;
+        }
+
+        struct sim_task *t = pick_ready_task();
+        if (t != NULL) {
+            if (t->yielded && ++s_spins_at_now > SIM_SPINS_PER_TICK) {
+                // Busy task never blocked: burn the rest of this tick
+                uint64_t next_tick = (s_now_us / SIM_US_PER_TICK + 1) * SIM_US_PER_TICK;
+                s_stats.busy_spins++;
+                if (next_tick > end_us) {
+                    s_now_us = end_us;
+                    return;
+                }
+                s_now_us = next_tick;
+                s_spins_at_now = 0;
+                continue;
+            }
+            run_task(t);
+            continue;
+        }
+
+        uint64_t next = next_wake_us();
+        if (next > end_us) {
+            s_now_us = end_us;
+            return;
+        }
+        s_now_us = next;
+    }
+}
+
+const sim_sched_stats_t *sim_sched_stats(void)
+{
+    return &s_stats;
+}
+
+void sim_report_tasks(FILE *out, double wall_s)
+{
+    fprintf(out, "  %-16s %4s %12s %12s %12s %12s %12s\n",
+            "task", "prio", "runs", "cpu_ms", "avg_us", "max_us", "max_late_ms");
+    double total_ms = 0;
+    for (int i = 0; i < s_task_count; i++) {
+        const struct sim_task *t = &s_tasks[i];
+        double cpu_ms = t->cpu_ns / 1e6;
+        total_ms += cpu_ms;
+        fprintf(out, "  %-16s %4u %12llu %12.2f %12.3f %12.3f %12.1f\n",
+                t->name, t->prio, (unsigned long long)t->runs, cpu_ms,
+                t->runs ? (t->cpu_ns / 1e3) / t->runs : 0.0,
+                t->max_run_ns / 1e3, t->max_late_us / 1e3);
+    }
+    if (s_esp_timer_runs > 0) {
+        double cpu_ms = s_esp_timer_ns / 1e6;
+        total_ms += cpu_ms;
+        fprintf(out, "  %-16s %4u %12llu %12.2f %12.3f %12.3f\n",
+                "esp_timer", 22, (unsigned long long)s_esp_timer_runs, cpu_ms,
+                (s_esp_timer_ns / 1e3) / s_esp_timer_runs, s_esp_timer_max_ns / 1e3);
+    }
+    fprintf(out, "  firmware cpu: %.2f ms of %.2f s host wall time\n",
+            total_ms, wall_s);
+}
+
+// ==================== FreeRTOS Tasks ====================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName,
+                                   uint32_t usStackDepth, void *pvParameters,
+                                   UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID)
+{
+    (void)usStackDepth;
+    (void)xCoreID;
+    if (s_task_count >= SIM_MAX_TASKS) {
+        return pdFAIL;
+    }
+    struct sim_task *t = &s_tasks[s_task_count++];
+    memset(t, 0, sizeof(*t));
+    snprintf(t->name, sizeof(t->name), "%s", pcName);
+    t->fn = pxTaskCode;
+    t->arg = pvParameters;
+    t->prio = uxPriority;
+    t->wake_us = s_now_us;
+    t->last_run_seq = 0;
+    t->stack = malloc(SIM_TASK_STACK_BYTES);
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack;
+    t->ctx.uc_stack.ss_size = SIM_TASK_STACK_BYTES;
+    t->ctx.uc_link = &s_sched_ctx;
+    makecontext(&t->ctx, task_trampoline, 0);
+    if (pxCreatedTask != NULL) {
+        *pxCreatedTask = t;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+                       uint32_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters,
+                                   uxPriority, pxCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    struct sim_task *t = (xTaskToDelete != NULL) ? xTaskToDelete : require_task("vTaskDelete");
+    t->dead = true;
+    if (t == s_current) {
+        task_yield();
+    }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    struct sim_task *self = require_task("vTaskDelay");
+    if (xTicksToDelay == 0) {
+        self->wake_us = s_now_us;
+        self->yielded = true;
+    } else {
+        // Unblocks on the tick boundary xTicksToDelay ticks from now
+        uint64_t tick = s_now_us / SIM_US_PER_TICK;
+        self->wake_us = (tick + xTicksToDelay) * SIM_US_PER_TICK;
+    }
+    task_yield();
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+    struct sim_task *self = require_task("xTaskDelayUntil");
+    TickType_t now = (TickType_t)(s_now_us / SIM_US_PER_TICK);
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    *pxPreviousWakeTime = wake;
+    // Already late: return at once, like the kernel does
+    if ((TickType_t)(wake - now) == 0 || (TickType_t)(wake - now) > xTimeIncrement) {
+        note_late((uint64_t)wake * SIM_US_PER_TICK);
+        return pdFALSE;
+    }
+    self->wake_us = (uint64_t)wake * SIM_US_PER_TICK;
+    task_yield();
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(s_now_us / SIM_US_PER_TICK);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current;
+}
+
+// ==================== Task Notifications ====================
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    return xTaskNotify(xTaskToNotify, 0, eIncrement);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction)
+{
+    switch (eAction) {
+        case eSetBits: xTaskToNotify->notify_count |= ulValue; break;
+        case eIncrement: xTaskToNotify->notify_count++; break;
+        case eSetValueWithOverwrite: xTaskToNotify->notify_count = ulValue; break;
+        case eNoAction: break;
+    }
+    xTaskToNotify->notify_pending = true;
+    sim_signal(&xTaskToNotify->notify_count);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+    struct sim_task *self = require_task("xTaskNotifyWait");
+    if (!self->notify_pending) {
+        self->notify_count &= ~ulBitsToClearOnEntry;
+    }
+    uint64_t deadline = ticks_to_deadline(xTicksToWait);
+    while (!self->notify_pending && s_now_us < deadline) {
+        sim_block_on(&self->notify_count, deadline);
+    }
+    if (pulNotificationValue != NULL) {
+        *pulNotificationValue = self->notify_count;
+    }
+    if (!self->notify_pending) {
+        return pdFALSE;
+    }
+    self->notify_pending = false;
+    self->notify_count &= ~ulBitsToClearOnExit;
+    return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    xTaskNotifyGive(xTaskToNotify);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    struct sim_task *self = require_task("ulTaskNotifyTake");
+    uint64_t deadline = ticks_to_deadline(xTicksToWait);
+    while (self->notify_count == 0 && s_now_us < deadline) {
+        sim_block_on(&self->notify_count, deadline);
+    }
+    uint32_t count = self->notify_count;
+    if (count > 0) {
+        self->notify_count = xClearCountOnExit ? 0 : count - 1;
+        self->notify_pending = false;
+    }
+    return count;
+}
+
+// ==================== Event Groups ====================
+
+struct sim_event_group {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct sim_event_group));
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    xEventGroup->bits |= uxBitsToSet;
+    sim_signal(xEventGroup);
+    return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+    EventBits_t prev = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    return prev;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup,
+                                const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit,
+                                const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+    uint64_t deadline = ticks_to_deadline(xTicksToWait);
+    for (;;) {
+        EventBits_t bits = xEventGroup->bits;
+        EventBits_t hit = bits & uxBitsToWaitFor;
+        bool done = xWaitForAllBits ? (hit == uxBitsToWaitFor) : (hit != 0);
+        if (done) {
+            if (xClearOnExit) {
+                xEventGroup->bits &= ~uxBitsToWaitFor;
+            }
+            return bits;
+        }
+        if (!sim_in_task() || s_now_us >= deadline) {
+            return bits;
+        }
+        sim_block_on(xEventGroup, deadline);
+    }
+}
+
+// ==================== Queues ====================
+
+struct sim_queue {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;           // Next item to receive
+    UBaseType_t count;
+    uint64_t *sent_us;          // Per slot: when the item was queued
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return NULL;
+    }
+    q->items = calloc(uxQueueLength, uxItemSize);
+    q->sent_us = calloc(uxQueueLength, sizeof(*q->sent_us));
+    if (q->items == NULL || q->sent_us == NULL) {
+        free(q->items);
+        free(q->sent_us);
+        free(q);
+        return NULL;
+    }
+    q->length = uxQueueLength;
+    q->item_size = uxItemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if (xQueue != NULL) {
+        free(xQueue->items);
+        free(xQueue->sent_us);
+        free(xQueue);
+    }
+}
+
+static uint8_t *queue_slot(QueueHandle_t q, UBaseType_t index)
+{
+    return q->items + ((q->head + index) % q->length) * q->item_size;
+}
+
+static uint64_t *queue_stamp(QueueHandle_t q, UBaseType_t index)
+{
+    return &q->sent_us[(q->head + index) % q->length];
+}
+
+// Senders and receivers both block on the queue object and re-check
+static bool queue_wait(QueueHandle_t q, uint64_t deadline)
+{
+    if (!sim_in_task() || s_now_us >= deadline) {
+        return false;
+    }
+    sim_block_on(q, deadline);
+    return true;
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    uint64_t deadline = ticks_to_deadline(ticks);
+    while (q->count == q->length) {
+        if (!queue_wait(q, deadline)) {
+            return errQUEUE_FULL;
+        }
+    }
+    if (front) {
+        q->head = (q->head + q->length - 1) % q->length;
+        memcpy(queue_slot(q, 0), item, q->item_size);
+        *queue_stamp(q, 0) = s_now_us;
+    } else {
+        memcpy(queue_slot(q, q->count), item, q->item_size);
+        *queue_stamp(q, q->count) = s_now_us;
+    }
+    q->count++;
+    sim_signal(q);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queue_send(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+{
+    xQueue->head = 0;
+    xQueue->count = 0;
+    return queue_send(xQueue, pvItemToQueue, 0, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue,
+                             BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    return queue_send(xQueue, pvItemToQueue, 0, false);
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void *buf, TickType_t ticks, bool remove)
+{
+    uint64_t deadline = ticks_to_deadline(ticks);
+    while (q->count == 0) {
+        if (!queue_wait(q, deadline)) {
+            return errQUEUE_EMPTY;
+        }
+    }
+    memcpy(buf, queue_slot(q, 0), q->item_size);
+    if (remove) {
+        note_late(*queue_stamp(q, 0));
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        sim_signal(q);
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    return queue_receive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    return xQueue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+    return xQueue->length - xQueue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    xQueue->head = 0;
+    xQueue->count = 0;
+    sim_signal(xQueue);
+    return pdPASS;
+}
+
+// ==================== esp_timer ====================
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t period_us;         // 0 for one-shot
+    sim_timer_t *sim;
+};
+
+static void esp_timer_dispatch(void *arg)
+{
+    struct esp_timer *timer = arg;
+    if (timer->period_us != 0) {
+        sim_timer_arm(timer->sim, s_now_us + timer->period_us);
+    }
+    note_wakeup();
+    uint64_t start = host_ns();
+    timer->callback(timer->arg);
+    uint64_t spent = host_ns() - start;
+    s_esp_timer_runs++;
+    s_esp_timer_ns += spent;
+    if (spent > s_esp_timer_max_ns) {
+        s_esp_timer_max_ns = spent;
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)s_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args == NULL || create_args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->sim = sim_timer_new(esp_timer_dispatch, timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (sim_timer_armed(timer->sim)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = 0;
+    sim_timer_arm(timer->sim, s_now_us + timeout_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (sim_timer_armed(timer->sim)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period;
+    sim_timer_arm(timer->sim, s_now_us + period);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!sim_timer_armed(timer->sim)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sim_timer_disarm(timer->sim);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    // The backing sim timer slot is not recycled; firmware creates its
+    // timers once at start-up.
+    sim_timer_disarm(timer->sim);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return sim_timer_armed(timer->sim);
+}
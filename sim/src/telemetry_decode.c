@@ -0,0 +1,129 @@
+/*
+ * Host Tool - Decode CBOR Telemetry Batches to JSON Records
+ *
+ * Reads telemetry bodies sent as application/cbor (telemetry_cbor.h),
+ * one or more back to back per file (the simulator's -T output is such a
+ * file), and prints the records as a JSON array shaped like
+ * sensor_data_7days.json: one object per record with deviceId, timestamp
+ * (s), lightValue, lightPercent, motion, lightOn and autoMode, followed by
+ * the fields the batch adds (ms, event, lightMv, lux, and the colour of a
+ * WS2812 build), and receivedAt/serverTimestamp as the server stamps them.
+ *
+ * Without SNTP the device clock counts from boot; -b gives the Unix time
+ * of boot so serverTimestamp lands on the real timeline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "telemetry_cbor.h"
+
+#define MAX_BATCH_RECORDS   1024
+
+static long long s_boot_unix = 0;
+static unsigned long s_records = 0;
+
+static void print_record(const telemetry_cbor_info_t *info, const telemetry_record_t *r)
+{
+    long long secs = r->t_ms / 1000;
+    long long server = s_boot_unix + secs;
+    time_t t = (time_t)server;
+    struct tm tm;
+    char received[32];
+    gmtime_r(&t, &tm);
+    strftime(received, sizeof(received), "%Y-%m-%d %H:%M:%S", &tm);
+
+    printf("%s    {\n", s_records++ ? ",\n" : "");
+    printf("        \"deviceId\": \"%s\",\n", info->device_id);
+    printf("        \"timestamp\": %lld,\n", secs);
+    printf("        \"lightValue\": %u,\n", r->light_value);
+    printf("        \"lightPercent\": %u,\n", r->light_percent);
+    printf("        \"motion\": %s,\n", r->motion ? "true" : "false");
+    printf("        \"lightOn\": %s,\n", r->light_on ? "true" : "false");
+    printf("        \"autoMode\": %s,\n", r->auto_mode ? "true" : "false");
+    printf("        \"ms\": %lld,\n", (long long)(r->t_ms % 1000));
+    printf("        \"event\": \"%s\",\n", telemetry_kind_name((telemetry_kind_t)r->kind));
+    printf("        \"lightMv\": %u,\n", r->light_mv);
+    printf("        \"lux\": %u,\n", r->light_lux);
+    if (info->has_color) {
+        printf("        \"red\": %u,\n        \"green\": %u,\n        \"blue\": %u,\n"
+               "        \"brightness\": %u,\n",
+               info->color[0], info->color[1], info->color[2], info->color[3]);
+    }
+    printf("        \"receivedAt\": \"%s\",\n", received);
+    printf("        \"serverTimestamp\": %lld\n", server);
+    printf("    }");
+}
+
+static int decode_file(const char *path)
+{
+    FILE *f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    size_t cap = 1 << 16, len = 0;
+    uint8_t *buf = malloc(cap);
+    size_t got;
+    while ((got = fread(buf + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    static telemetry_record_t rec[MAX_BATCH_RECORDS];
+    size_t pos = 0;
+    int rc = 0;
+    while (pos < len) {
+        telemetry_cbor_info_t info;
+        size_t used = telemetry_cbor_decode(buf + pos, len - pos, &info, rec, MAX_BATCH_RECORDS);
+        if (used == 0) {
+            fprintf(stderr, "%s: malformed batch at byte %zu\n", path, pos);
+            rc = 1;
+            break;
+        }
+        if (info.count > MAX_BATCH_RECORDS) {
+            fprintf(stderr, "%s: batch at byte %zu has %u records, kept %d\n",
+                    path, pos, info.count, MAX_BATCH_RECORDS);
+            info.count = MAX_BATCH_RECORDS;
+        }
+        for (uint32_t i = 0; i < info.count; i++) {
+            print_record(&info, &rec[i]);
+        }
+        pos += used;
+    }
+    free(buf);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "b:h")) != -1) {
+        switch (opt) {
+            case 'b': s_boot_unix = atoll(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-b boot_unix_time] file... (- for stdin)\n", argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        fprintf(stderr, "usage: %s [-b boot_unix_time] file... (- for stdin)\n", argv[0]);
+        return 1;
+    }
+
+    int rc = 0;
+    printf("[\n");
+    for (int i = optind; i < argc; i++) {
+        rc |= decode_file(argv[i]);
+    }
+    printf("%s]\n", s_records ? "\n" : "");
+    return rc;
+}
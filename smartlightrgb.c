@@ -9,33 +9,98 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali_scheme.h"
 #include "esp_http_server.h"
+#include "esp_pm.h"
+#include "auto_light.h"
+#include "adc_filter.h"
+#include "light_cal.h"
+#include "seqlock.h"
+#include "json_writer.h"
 #include "cJSON.h"
 
 // WiFi Configuration - Change to your WiFi info
 #define WIFI_SSID      "4THU_Z95XZQ_2.4Ghz"
 #define WIFI_PASS      "3n6xhs3z8p8f"
 #define WIFI_MAXIMUM_RETRY  5
+#define WIFI_RETRY_MIN_MS   10000   // Then keep retrying, backing off from 10 s
+#define WIFI_RETRY_MAX_MS   300000  // to 5 minutes between attempts
 
 // GPIO Pin Definitions
 #define PIR_SENSOR_PIN      GPIO_NUM_13    // PIR Motion Sensor
-#define LIGHT_SENSOR_PIN    ADC1_CHANNEL_6 // GPIO34 (ADC1_CH6)
+#define LIGHT_SENSOR_PIN    ADC_CHANNEL_6  // GPIO34 (ADC1_CH6)
 #define RELAY_PIN           GPIO_NUM_12    // Relay Control
 
 // Light Threshold (0-4095)
 #define LIGHT_THRESHOLD     1500
 
+// Auto Mode Switching (see auto_light.h): once dark, it only counts as
+// bright again LIGHT_HYSTERESIS past the threshold. Timings are in ms.
+#ifndef LIGHT_HYSTERESIS
+#define LIGHT_HYSTERESIS    200
+#endif
+#ifndef MOTION_HOLD_MS
+#define MOTION_HOLD_MS      30000
+#endif
+#ifndef MIN_ON_MS
+#define MIN_ON_MS           5000
+#endif
+#ifndef MIN_OFF_MS
+#define MIN_OFF_MS          2000
+#endif
+
+// PIR Handling: 1 = edge interrupt posts motion events immediately,
+// 0 = PIR level is polled by the sensor sampler
+#ifndef PIR_USE_INTERRUPT
+#define PIR_USE_INTERRUPT   1
+#endif
+
+// Sensor Sampling Period (ms): the light sensor is read off the control
+// task and only threshold crossings are forwarded to it. Without the PIR
+// interrupt the PIR is polled here too, at the old loop period.
+#if PIR_USE_INTERRUPT
+#define SENSOR_SAMPLE_PERIOD_MS 1000
+#else
+#define SENSOR_SAMPLE_PERIOD_MS 100
+#endif
+
+// Light Sensor Sampling: each period converts one burst of
+// LIGHT_ADC_BLOCK samples by DMA (continuous mode) and reduces it to one
+// reading with LIGHT_FILTER. The converter is stopped between bursts.
+#define LIGHT_ADC_SAMPLE_HZ     20000   // Lowest continuous-mode rate on the ESP32
+#define LIGHT_ADC_BLOCK         64      // Samples per burst (3.2 ms)
+#define LIGHT_ADC_TIMEOUT_MS    20
+#ifndef LIGHT_FILTER
+#define LIGHT_FILTER            ADC_FILTER_MOVING_AVG()
+#endif
+
+// Light Sensor Divider (see light_cal.h): GL5528-type LDR and a 10k
+// resistor across 3.3V, LDR on the 3.3V side
+#define LDR_FIXED_OHMS          10000
+#define LDR_R10_OHMS            15000   // LDR resistance at 10 lux
+#define LDR_GAMMA               0.7f
+#define ADC_DEFAULT_VREF        1100    // Used when eFuse holds no Vref
+
+// Light Sleep between events (needs CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE). Off by default: GPIO edges are not
+// latched while asleep, so motion would only be seen on the next sample.
+#ifndef CTRL_LIGHT_SLEEP
+#define CTRL_LIGHT_SLEEP    0
+#endif
+
 // Log Tag
 static const char *TAG = "SmartLight";
 
@@ -43,7 +108,10 @@ static const char *TAG = "SmartLight";
 typedef struct {
     bool is_auto_mode;      // Auto/Manual Mode
     bool is_light_on;       // Light Status
-    int light_value;        // Light Sensor Value
+    int light_value;        // Light Sensor Value (filtered raw)
+    int light_mv;           // Calibrated (see light_cal.h)
+    int light_lux;
+    int light_percent;      // 0 = darkest, 100 = brightest
     bool motion_detected;   // Motion Detection Status
 } system_state_t;
 
@@ -54,6 +122,43 @@ static system_state_t system_state = {
     .motion_detected = false
 };
 
+// system_state Access: the control task (and the sampler, for the light
+// fields) update it between state_write_begin/end; everyone else takes a
+// consistent copy with state_snapshot() (see seqlock.h)
+static seqlock_t system_state_seq = SEQLOCK_INIT;
+static portMUX_TYPE system_state_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void state_write_begin(void)
+{
+    taskENTER_CRITICAL(&system_state_mux);
+    seqlock_write_begin(&system_state_seq);
+}
+
+static void status_push_kick(void);
+static void status_push_light(int raw);
+
+// Ends an update without waking the status push (see set_light_reading)
+static inline void state_write_end_nopush(void)
+{
+    seqlock_write_end(&system_state_seq);
+    taskEXIT_CRITICAL(&system_state_mux);
+}
+
+static inline void state_write_end(void)
+{
+    state_write_end_nopush();
+    status_push_kick();
+}
+
+static void state_snapshot(system_state_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&system_state_seq);
+        *out = system_state;
+    } while (seqlock_read_retry(&system_state_seq, seq));
+}
+
 // WiFi Event Group
 static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
@@ -62,29 +167,89 @@ static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 static httpd_handle_t server = NULL;
 
-// ADC Calibration
-static esp_adc_cal_characteristics_t *adc_chars;
+// Light Sensor ADC (continuous mode) and its block filter
+static adc_continuous_handle_t light_adc = NULL;
+static adc_filter_t light_filter = LIGHT_FILTER;
+
+// Light Sensor Calibration: raw -> mV / lux / percent table, built at boot
+static const light_cal_config_t light_cal_cfg = {
+    .vcc_mv = 3300,
+    .fixed_ohms = LDR_FIXED_OHMS,
+    .ldr_r10_ohms = LDR_R10_OHMS,
+    .ldr_gamma = LDR_GAMMA,
+    .ldr_to_gnd = false,
+};
+static light_cal_t light_cal;
+
+// Control Events: everything that can change the light goes through
+// one queue, so the control task is the only writer of the outputs
+typedef enum {
+    CTRL_EVT_PIR_EDGE,      // PIR level changed
+    CTRL_EVT_LIGHT_CROSS,   // Light reading went dark or bright
+    CTRL_EVT_AUTO_TIMER,    // Motion hold-off or dwell time ran out
+    CTRL_EVT_SET_LIGHT,     // HTTP /control (value: 1 = on)
+    CTRL_EVT_SET_MODE,      // HTTP /mode (value: 1 = auto)
+} ctrl_event_type_t;
+
+typedef struct {
+    ctrl_event_type_t type;
+    int64_t at_us;          // esp_timer time the event was raised
+    int value;              // Event argument (reading, on/off, ...)
+} ctrl_event_t;
+
+#define CTRL_EVT_QUEUE_LEN  16
+static QueueHandle_t ctrl_evt_queue = NULL;
+
+// Auto Mode State Machine
+// Dark = low ADC value on this board
+static const auto_light_config_t auto_light_cfg = {
+    .dark_threshold = LIGHT_THRESHOLD,
+    .bright_threshold = LIGHT_THRESHOLD + LIGHT_HYSTERESIS,
+    .dark_is_high = false,
+    .motion_hold_ms = MOTION_HOLD_MS,
+    .min_on_ms = MIN_ON_MS,
+    .min_off_ms = MIN_OFF_MS,
+};
+static auto_light_t auto_light;
+static esp_timer_handle_t auto_light_timer = NULL;
 
 // ==================== WiFi Event Handling ====================
 
+// WiFi Reconnect: once the quick retries are used up, keep trying on a
+// backoff timer instead of staying offline until the next reboot
+static esp_timer_handle_t wifi_retry_timer = NULL;
+static uint32_t wifi_retry_ms = WIFI_RETRY_MIN_MS;
+
+static void wifi_retry_cb(void *arg)
+{
+    ESP_LOGI(TAG, "Retrying WiFi connection...");
+    esp_wifi_connect();
+}
+
 static void event_handler(void* arg, esp_event_base_t event_base,
                           int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         if (s_retry_num < WIFI_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
             ESP_LOGI(TAG, "Retrying WiFi connection...");
         } else {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+            ESP_LOGW(TAG, "WiFi unavailable, next attempt in %lu s", (unsigned long)(wifi_retry_ms / 1000));
+            esp_timer_start_once(wifi_retry_timer, (uint64_t)wifi_retry_ms * 1000);
+            wifi_retry_ms = (wifi_retry_ms * 2 < WIFI_RETRY_MAX_MS) ? wifi_retry_ms * 2 : WIFI_RETRY_MAX_MS;
         }
         ESP_LOGI(TAG, "Failed to connect to AP");
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "Got IP Address:" IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        wifi_retry_ms = WIFI_RETRY_MIN_MS;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -93,6 +258,11 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 void wifi_init_sta(void)
 {
     s_wifi_event_group = xEventGroupCreate();
+    const esp_timer_create_args_t retry_args = {
+        .callback = wifi_retry_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_args, &wifi_retry_timer));
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -148,7 +318,10 @@ void wifi_init_sta(void)
 void turn_on_light(void)
 {
     gpio_set_level(RELAY_PIN, 1);
+    state_write_begin();
     system_state.is_light_on = true;
+    state_write_end();
+    auto_light_note_switch(&auto_light, true, esp_timer_get_time());
     ESP_LOGI(TAG, "Light Turned ON");
 }
 
@@ -156,14 +329,53 @@ void turn_on_light(void)
 void turn_off_light(void)
 {
     gpio_set_level(RELAY_PIN, 0);
+    state_write_begin();
     system_state.is_light_on = false;
+    state_write_end();
+    auto_light_note_switch(&auto_light, false, esp_timer_get_time());
     ESP_LOGI(TAG, "Light Turned OFF");
 }
 
 // Read Light Sensor
 int read_light_sensor(void)
 {
-    return adc1_get_raw(LIGHT_SENSOR_PIN);
+    static uint8_t frame[LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES];
+    uint16_t block[LIGHT_ADC_BLOCK];
+    uint32_t len = 0;
+    size_t n = 0;
+    
+    esp_err_t err = adc_continuous_start(light_adc);
+    if (err == ESP_OK) {
+        err = adc_continuous_read(light_adc, frame, sizeof(frame), &len, LIGHT_ADC_TIMEOUT_MS);
+        adc_continuous_stop(light_adc);
+        adc_continuous_flush_pool(light_adc);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sensor read failed: %s", esp_err_to_name(err));
+        return system_state.light_value;
+    }
+    
+    const adc_digi_output_data_t *out = (const adc_digi_output_data_t *)frame;
+    for (uint32_t i = 0; i < len / SOC_ADC_DIGI_RESULT_BYTES; i++) {
+        if (out[i].type1.channel == LIGHT_SENSOR_PIN) {
+            block[n++] = out[i].type1.data;
+        }
+    }
+    return (n > 0) ? adc_filter_run(&light_filter, block, n) : system_state.light_value;
+}
+
+// Store a filtered reading with its calibrated values
+static void set_light_reading(int raw)
+{
+    light_reading_t r;
+    light_cal_read(&light_cal, raw, &r);
+    state_write_begin();
+    system_state.light_value = r.raw;
+    system_state.light_mv = r.mv;
+    system_state.light_lux = r.lux;
+    system_state.light_percent = r.percent;
+    state_write_end_nopush();
+    status_push_light(r.raw);
 }
 
 // Read PIR Sensor
@@ -172,6 +384,116 @@ bool read_pir_sensor(void)
     return gpio_get_level(PIR_SENSOR_PIN);
 }
 
+// Post a control event from task context; never blocks the caller
+static bool post_ctrl_event(ctrl_event_type_t type, int value)
+{
+    ctrl_event_t evt = { .type = type, .at_us = esp_timer_get_time(), .value = value };
+    if (xQueueSend(ctrl_evt_queue, &evt, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Control queue full, event %d dropped", type);
+        return false;
+    }
+    return true;
+}
+
+#if PIR_USE_INTERRUPT
+// PIR Edge Interrupt: hand the edge to the control task, which re-reads
+// the level itself so a bounced edge can't leave a stale state behind
+static void IRAM_ATTR pir_isr_handler(void *arg)
+{
+    ctrl_event_t evt = { .type = CTRL_EVT_PIR_EDGE, .at_us = esp_timer_get_time() };
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(ctrl_evt_queue, &evt, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void pir_interrupt_init(void)
+{
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(PIR_SENSOR_PIN, pir_isr_handler, NULL));
+}
+#endif
+
+// Calibration scheme callback for light_cal_build(); nominal 0-3.1V
+// scale without one
+static int light_cali_mv(int raw, void *ctx)
+{
+    int mv = raw * 3100 / 4095;
+    if (ctx != NULL) {
+        adc_cali_raw_to_voltage((adc_cali_handle_t)ctx, raw, &mv);
+    }
+    return mv;
+}
+
+// Light Sensor ADC: one-channel continuous-mode driver, started per burst
+static void light_adc_init(void)
+{
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES * 2,
+        .conv_frame_size = LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES,
+    };
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_cfg, &light_adc));
+    
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = LIGHT_SENSOR_PIN,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t adc_config = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = LIGHT_ADC_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    ESP_ERROR_CHECK(adc_continuous_config(light_adc, &adc_config));
+    
+    // Calibration: the table is all that's kept, the scheme is freed again
+    adc_cali_handle_t cali = NULL;
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+        .default_vref = ADC_DEFAULT_VREF,
+    };
+    esp_err_t err = adc_cali_create_scheme_line_fitting(&cali_config, &cali);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "ADC calibration unavailable (%s), using nominal scale", esp_err_to_name(err));
+    }
+    light_cal_build(&light_cal, &light_cal_cfg, light_cali_mv, cali);
+    if (cali != NULL) {
+        adc_cali_delete_scheme_line_fitting(cali);
+    }
+    ESP_LOGI(TAG, "Light sensor: %d-sample bursts at %d Hz, %s filter",
+             LIGHT_ADC_BLOCK, LIGHT_ADC_SAMPLE_HZ, light_filter.name);
+}
+
+// Sensor Sampler Task: filters one ADC burst per period below the control
+// task's priority, forwards light threshold crossings, and PIR changes the
+// interrupt did not report (polling build, missed edges)
+void sensor_sample_task(void *pvParameters)
+{
+    bool was_dark = auto_light_classify(&auto_light_cfg, false, system_state.light_value);
+    TickType_t last_wake = xTaskGetTickCount();
+    
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSOR_SAMPLE_PERIOD_MS));
+        
+        int value = read_light_sensor();
+        set_light_reading(value);
+        bool dark = auto_light_classify(&auto_light_cfg, was_dark, value);
+        if (dark != was_dark && post_ctrl_event(CTRL_EVT_LIGHT_CROSS, value)) {
+            was_dark = dark;
+        }
+        
+        if (read_pir_sensor() != system_state.motion_detected) {
+            post_ctrl_event(CTRL_EVT_PIR_EDGE, 0);
+        }
+    }
+}
+
 // ==================== HTTP Server Handling ====================
 
 // Return HTML Page
@@ -311,20 +633,23 @@ static const char* get_html_page(void)
 "    </div>\n"
 "    <script>\n"
 "        let currentMode = true;\n"
+"        let deviceState = {};\n"
+"        function render(data) {\n"
+"            document.getElementById('lightStatus').textContent = data.lightOn ? 'ON' : 'OFF';\n"
+"            document.getElementById('lightIndicator').className = 'indicator ' + (data.lightOn ? 'on' : 'off');\n"
+"            document.getElementById('motionStatus').textContent = data.motion ? 'Detected' : 'Clear';\n"
+"            document.getElementById('motionIndicator').className = 'indicator ' + (data.motion ? 'on' : 'off');\n"
+"            document.getElementById('lightBar').style.width = data.lightPercent + '%';\n"
+"            document.getElementById('lightBar').textContent = data.lightPercent + '% (' + data.lux + ' lx)';\n"
+"            currentMode = data.autoMode;\n"
+"            updateModeUI();\n"
+"            document.getElementById('updateTime').textContent = new Date().toLocaleTimeString();\n"
+"        }\n"
 "        async function updateStatus() {\n"
 "            try {\n"
 "                const response = await fetch('/status');\n"
-"                const data = await response.json();\n"
-"                document.getElementById('lightStatus').textContent = data.lightOn ? 'ON' : 'OFF';\n"
-"                document.getElementById('lightIndicator').className = 'indicator ' + (data.lightOn ? 'on' : 'off');\n"
-"                document.getElementById('motionStatus').textContent = data.motion ? 'Detected' : 'Clear';\n"
-"                document.getElementById('motionIndicator').className = 'indicator ' + (data.motion ? 'on' : 'off');\n"
-"                const lightPercent = Math.round((data.lightValue / 4095) * 100);\n"
-"                document.getElementById('lightBar').style.width = lightPercent + '%';\n"
-"                document.getElementById('lightBar').textContent = lightPercent + '%';\n"
-"                currentMode = data.autoMode;\n"
-"                updateModeUI();\n"
-"                document.getElementById('updateTime').textContent = new Date().toLocaleTimeString();\n"
+"                deviceState = await response.json();\n"
+"                render(deviceState);\n"
 "            } catch (error) {\n"
 "                console.error('Update failed:', error);\n"
 "            }\n"
@@ -374,8 +699,26 @@ static const char* get_html_page(void)
 "                console.error('Control failed:', error);\n"
 "            }\n"
 "        }\n"
+"        // Live updates: /ws sends the full status, then only changed fields.\n"
+"        // While it is down, poll /status and keep trying to reconnect.\n"
+"        let pollTimer = null;\n"
+"        function connectPush() {\n"
+"            const ws = new WebSocket('ws://' + location.host + '/ws');\n"
+"            ws.onopen = () => {\n"
+"                clearInterval(pollTimer);\n"
+"                pollTimer = null;\n"
+"            };\n"
+"            ws.onmessage = (event) => {\n"
+"                Object.assign(deviceState, JSON.parse(event.data));\n"
+"                render(deviceState);\n"
+"            };\n"
+"            ws.onclose = () => {\n"
+"                if (pollTimer === null) pollTimer = setInterval(updateStatus, 1000);\n"
+"                setTimeout(connectPush, 3000);\n"
+"            };\n"
+"        }\n"
 "        updateStatus();\n"
-"        setInterval(updateStatus, 1000);\n"
+"        connectPush();\n"
 "    </script>\n"
 "</body>\n"
 "</html>";
@@ -393,6 +736,29 @@ static esp_err_t root_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Status payload is built on the stack, no cJSON tree (see json_writer.h)
+#define STATUS_JSON_MAX     256
+
+// Status fields, or with prev set only those that differ from it (a delta)
+static void status_add_fields(json_writer_t *w, const system_state_t *s, const system_state_t *prev)
+{
+    if (prev == NULL || s->is_light_on != prev->is_light_on) {
+        json_add_bool(w, "lightOn", s->is_light_on);
+    }
+    if (prev == NULL || s->is_auto_mode != prev->is_auto_mode) {
+        json_add_bool(w, "autoMode", s->is_auto_mode);
+    }
+    if (prev == NULL || s->light_value != prev->light_value) {
+        json_add_int(w, "lightValue", s->light_value);
+        json_add_int(w, "lightPercent", s->light_percent);
+        json_add_int(w, "lightMv", s->light_mv);
+        json_add_int(w, "lux", s->light_lux);
+    }
+    if (prev == NULL || s->motion_detected != prev->motion_detected) {
+        json_add_bool(w, "motion", s->motion_detected);
+    }
+}
+
 // HTTP GET Handler - Status Query
 static esp_err_t status_get_handler(httpd_req_t *req)
 {
@@ -401,19 +767,22 @@ static esp_err_t status_get_handler(httpd_req_t *req)
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
     
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddBoolToObject(root, "lightOn", system_state.is_light_on);
-    cJSON_AddBoolToObject(root, "autoMode", system_state.is_auto_mode);
-    cJSON_AddNumberToObject(root, "lightValue", system_state.light_value);
-    cJSON_AddBoolToObject(root, "motion", system_state.motion_detected);
+    system_state_t state;
+    state_snapshot(&state);
     
-    const char *json_str = cJSON_Print(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_str, strlen(json_str));
+    char buf[STATUS_JSON_MAX];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w, NULL);
+    status_add_fields(&w, &state, NULL);
+    json_obj_end(&w);
     
-    free((void *)json_str);
-    cJSON_Delete(root);
-    return ESP_OK;
+    if (!json_writer_ok(&w)) {
+        ESP_LOGE(TAG, "Status payload exceeds %d bytes", STATUS_JSON_MAX);
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, w.len);
 }
 
 // HTTP POST Handler - Light Control
@@ -440,10 +809,10 @@ static esp_err_t control_post_handler(httpd_req_t *req)
     
     cJSON *light = cJSON_GetObjectItem(root, "light");
     if (cJSON_IsBool(light) && !system_state.is_auto_mode) {
-        if (cJSON_IsTrue(light)) {
-            turn_on_light();
-        } else {
-            turn_off_light();
+        if (!post_ctrl_event(CTRL_EVT_SET_LIGHT, cJSON_IsTrue(light))) {
+            cJSON_Delete(root);
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
         }
         httpd_resp_set_type(req, "application/json");
         httpd_resp_send(req, "{\"success\":true}", 17);
@@ -481,8 +850,11 @@ static esp_err_t mode_post_handler(httpd_req_t *req)
     
     cJSON *auto_mode = cJSON_GetObjectItem(root, "auto");
     if (cJSON_IsBool(auto_mode)) {
-        system_state.is_auto_mode = cJSON_IsTrue(auto_mode);
-        ESP_LOGI(TAG, "Mode switch: %s", system_state.is_auto_mode ? "Auto" : "Manual");
+        if (!post_ctrl_event(CTRL_EVT_SET_MODE, cJSON_IsTrue(auto_mode))) {
+            cJSON_Delete(root);
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
         httpd_resp_set_type(req, "application/json");
         httpd_resp_send(req, "{\"success\":true}", 17);
     } else {
@@ -515,6 +887,173 @@ static esp_err_t control_options_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// WebSocket /ws: a client gets the full status once connected, then only
+// the fields that changed. Changes within STATUS_PUSH_COALESCE_MS go out
+// as one frame; the light reading only counts as changed once it has moved
+// by STATUS_PUSH_LIGHT_STEP, so sensor noise does not stream to clients.
+// Needs CONFIG_HTTPD_WS_SUPPORT.
+#ifndef STATUS_PUSH_COALESCE_MS
+#define STATUS_PUSH_COALESCE_MS 50
+#endif
+#define STATUS_PUSH_LIGHT_STEP  32
+#define STATUS_PUSH_MAX_CLIENTS 4
+#define STATUS_WS_RX_MAX        64
+
+typedef struct {
+    int fd;
+    bool used;
+    bool fresh;             // Connected since the last push: owed the full status
+} ws_client_t;
+
+// Clients and the last pushed state are only touched in the server task
+static ws_client_t ws_clients[STATUS_PUSH_MAX_CLIENTS];
+static system_state_t push_sent;
+static volatile int ws_client_count = 0;
+static esp_timer_handle_t status_push_timer = NULL;
+
+static bool ws_client_add(int fd)
+{
+    for (int i = 0; i < STATUS_PUSH_MAX_CLIENTS; i++) {
+        if (!ws_clients[i].used) {
+            ws_clients[i] = (ws_client_t){ .fd = fd, .used = true, .fresh = true };
+            ws_client_count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ws_client_drop(ws_client_t *client)
+{
+    ESP_LOGI(TAG, "Status push: client %d gone", client->fd);
+    client->used = false;
+    ws_client_count--;
+}
+
+static bool ws_send_text(int fd, const char *buf, size_t len)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)buf,
+        .len = len,
+    };
+    return httpd_ws_send_frame_async(server, fd, &frame) == ESP_OK;
+}
+
+// Runs in the server task (httpd_queue_work), which owns the sockets
+static void status_push_work(void *arg)
+{
+    system_state_t state;
+    state_snapshot(&state);
+    
+    char full[STATUS_JSON_MAX];
+    json_writer_t fw;
+    json_writer_init(&fw, full, sizeof(full));
+    json_obj_begin(&fw, NULL);
+    status_add_fields(&fw, &state, NULL);
+    json_obj_end(&fw);
+    
+    // Below the step, clients keep the reading they already have
+    if (abs(state.light_value - push_sent.light_value) < STATUS_PUSH_LIGHT_STEP) {
+        state.light_value = push_sent.light_value;
+        state.light_mv = push_sent.light_mv;
+        state.light_lux = push_sent.light_lux;
+        state.light_percent = push_sent.light_percent;
+    }
+    char delta[STATUS_JSON_MAX];
+    json_writer_t dw;
+    json_writer_init(&dw, delta, sizeof(delta));
+    json_obj_begin(&dw, NULL);
+    status_add_fields(&dw, &state, &push_sent);
+    json_obj_end(&dw);
+    bool changed = dw.len > 2;     // More than "{}"
+    
+    if (!json_writer_ok(&fw) || !json_writer_ok(&dw)) {
+        ESP_LOGE(TAG, "Status payload exceeds %d bytes", STATUS_JSON_MAX);
+        return;
+    }
+    for (int i = 0; i < STATUS_PUSH_MAX_CLIENTS; i++) {
+        ws_client_t *client = &ws_clients[i];
+        if (!client->used) {
+            continue;
+        }
+        if (httpd_ws_get_fd_info(server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_client_drop(client);
+            continue;
+        }
+        bool sent = true;
+        if (client->fresh) {
+            sent = ws_send_text(client->fd, full, fw.len);
+            client->fresh = false;
+        } else if (changed) {
+            sent = ws_send_text(client->fd, delta, dw.len);
+        }
+        if (!sent) {
+            ws_client_drop(client);
+        }
+    }
+    push_sent = state;
+}
+
+static void status_push_timer_cb(void *arg)
+{
+    if (httpd_queue_work(server, status_push_work, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Status push not queued");
+    }
+}
+
+// Called after every system_state update, from any task
+static void status_push_kick(void)
+{
+    // Already armed: this change goes out with the pending push
+    if (ws_client_count > 0 && status_push_timer != NULL &&
+        !esp_timer_is_active(status_push_timer)) {
+        esp_timer_start_once(status_push_timer, STATUS_PUSH_COALESCE_MS * 1000);
+    }
+}
+
+// Sensor noise moves the reading a little every sample: only wake the push
+// once it is STATUS_PUSH_LIGHT_STEP away from what clients were sent. The
+// unlocked read of push_sent is one aligned word; a stale value only moves
+// the push by a sample.
+static void status_push_light(int raw)
+{
+    if (abs(raw - push_sent.light_value) >= STATUS_PUSH_LIGHT_STEP) {
+        status_push_kick();
+    }
+}
+
+static void status_push_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = status_push_timer_cb,
+        .name = "status_push"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &status_push_timer));
+}
+
+// WebSocket Handler - Status Push (/ws)
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake done: the next push sends this client the full status
+        int fd = httpd_req_to_sockfd(req);
+        if (!ws_client_add(fd)) {
+            ESP_LOGW(TAG, "Status push: no room for client %d", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Status push: client %d connected", fd);
+        status_push_kick();
+        return ESP_OK;
+    }
+    
+    // Clients send nothing we act on; read the frame and drop it
+    uint8_t payload[STATUS_WS_RX_MAX];
+    httpd_ws_frame_t frame = { .payload = payload };
+    return httpd_ws_recv_frame(req, &frame, sizeof(payload));
+}
+
 // URI Handlers Definition
 static const httpd_uri_t root = {
     .uri       = "/",
@@ -552,6 +1091,13 @@ static const httpd_uri_t control_options = {
     .handler   = control_options_handler
 };
 
+static const httpd_uri_t ws = {
+    .uri          = "/ws",
+    .method       = HTTP_GET,
+    .handler      = ws_handler,
+    .is_websocket = true
+};
+
 // Start HTTP Server
 static httpd_handle_t start_webserver(void)
 {
@@ -568,6 +1114,8 @@ static httpd_handle_t start_webserver(void)
         httpd_register_uri_handler(server, &control_options);
         httpd_register_uri_handler(server, &mode);
         httpd_register_uri_handler(server, &mode_options);
+        httpd_register_uri_handler(server, &ws);
+        status_push_init();
         return server;
     }
 
@@ -577,29 +1125,96 @@ static httpd_handle_t start_webserver(void)
 
 // ==================== Main Task ====================
 
-// Sensor Reading Task
-void sensor_task(void *pvParameters)
+// Auto mode logic
+static void evaluate_auto_mode(void)
+{
+    if (!system_state.is_auto_mode) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t recheck_us;
+    bool should_light_on = auto_light_decide(&auto_light, now, &recheck_us);
+    
+    if (should_light_on && !system_state.is_light_on) {
+        turn_on_light();
+    } else if (!should_light_on && system_state.is_light_on) {
+        turn_off_light();
+    }
+    
+    // Come back when the hold-off or dwell time runs out
+    esp_timer_stop(auto_light_timer);
+    if (recheck_us != AUTO_LIGHT_NO_RECHECK) {
+        esp_timer_start_once(auto_light_timer, recheck_us - now);
+    }
+}
+static void auto_light_timer_cb(void *arg)
+{
+    post_ctrl_event(CTRL_EVT_AUTO_TIMER, 0);
+}
+
+// Control Task: blocks until an event arrives, applies it, re-evaluates
+void control_task(void *pvParameters)
 {
-    ESP_LOGI(TAG, "Sensor task started");
+    ESP_LOGI(TAG, "Control task started");
+    
+    // Start from the current inputs instead of waiting for the first event
+    bool initial_motion = read_pir_sensor();
+    state_write_begin();
+    system_state.motion_detected = initial_motion;
+    state_write_end();
+    auto_light_init(&auto_light, &auto_light_cfg, system_state.light_value,
+                    system_state.motion_detected, system_state.is_light_on, esp_timer_get_time());
     
+    const esp_timer_create_args_t auto_timer_args = {
+        .callback = auto_light_timer_cb,
+        .name = "auto_light",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&auto_timer_args, &auto_light_timer));
+    evaluate_auto_mode();
+    
+    ctrl_event_t evt;
     while (1) {
-        // Read sensors
-        system_state.light_value = read_light_sensor();
-        system_state.motion_detected = read_pir_sensor();
+        xQueueReceive(ctrl_evt_queue, &evt, portMAX_DELAY);
         
-        // Auto mode logic
-        if (system_state.is_auto_mode) {
-            bool should_light_on = (system_state.light_value < LIGHT_THRESHOLD) && 
-                                   system_state.motion_detected;
-            
-            if (should_light_on && !system_state.is_light_on) {
-                turn_on_light();
-            } else if (!should_light_on && system_state.is_light_on) {
-                turn_off_light();
+        switch (evt.type) {
+            case CTRL_EVT_PIR_EDGE: {
+                bool motion = read_pir_sensor();
+                if (motion == system_state.motion_detected) {
+                    continue;  // Bounce or already handled
+                }
+                // The sampler keeps light_value fresh; no ADC work here
+                state_write_begin();
+                system_state.motion_detected = motion;
+                state_write_end();
+                auto_light_set_light(&auto_light, system_state.light_value);
+                auto_light_set_motion(&auto_light, motion, esp_timer_get_time());
+                break;
             }
+            case CTRL_EVT_LIGHT_CROSS:
+                // The sampler has already stored the reading
+                auto_light_set_light(&auto_light, evt.value);
+                break;
+            case CTRL_EVT_AUTO_TIMER:
+                break;
+            case CTRL_EVT_SET_LIGHT:
+                // Mode may have changed since the handler checked it
+                if (!system_state.is_auto_mode) {
+                    if (evt.value) {
+                        turn_on_light();
+                    } else {
+                        turn_off_light();
+                    }
+                }
+                break;
+            case CTRL_EVT_SET_MODE:
+                state_write_begin();
+                system_state.is_auto_mode = evt.value;
+                state_write_end();
+                ESP_LOGI(TAG, "Mode switch: %s", system_state.is_auto_mode ? "Auto" : "Manual");
+                break;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(100)); // 100ms delay
+        evaluate_auto_mode();
     }
 }
 
@@ -607,16 +1222,22 @@ void sensor_task(void *pvParameters)
 
 void hardware_init(void)
 {
+    // Control event queue (the PIR ISR and sampler post into it)
+    ctrl_evt_queue = xQueueCreate(CTRL_EVT_QUEUE_LEN, sizeof(ctrl_event_t));
+    
     // Configure GPIO
     gpio_config_t io_conf = {};
     
     // PIR Sensor Input
-    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.intr_type = PIR_USE_INTERRUPT ? GPIO_INTR_ANYEDGE : GPIO_INTR_DISABLE;
     io_conf.mode = GPIO_MODE_INPUT;
     io_conf.pin_bit_mask = (1ULL << PIR_SENSOR_PIN);
     io_conf.pull_down_en = 0;
     io_conf.pull_up_en = 0;
     gpio_config(&io_conf);
+#if PIR_USE_INTERRUPT
+    pir_interrupt_init();
+#endif
     
     // Relay Output
     io_conf.intr_type = GPIO_INTR_DISABLE;
@@ -629,14 +1250,9 @@ void hardware_init(void)
     // Initialize Relay to OFF
     gpio_set_level(RELAY_PIN, 0);
     
-    // Configure ADC
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(LIGHT_SENSOR_PIN, ADC_ATTEN_DB_11);
-    
-    // ADC Calibration
-    adc_chars = calloc(1, sizeof(esp_adc_cal_characteristics_t));
-    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 
-                             1100, adc_chars);
+    // Configure ADC and take the first reading
+    light_adc_init();
+    set_light_reading(read_light_sensor());
     
     ESP_LOGI(TAG, "Hardware initialization complete");
 }
@@ -664,8 +1280,22 @@ void app_main(void)
     // Start HTTP Server
     server = start_webserver();
     
-    // Create Sensor Task
-    xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 5, NULL);
+    // Create Control Task and start feeding it sensor events
+    xTaskCreate(control_task, "control_task", 4096, NULL, 5, NULL);
+    xTaskCreate(sensor_sample_task, "sensor_sample", 3072, NULL, 3, NULL);
+    
+#if CTRL_LIGHT_SLEEP
+    // Idle between events in light sleep
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = 240,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true,
+    };
+    esp_err_t pm_err = esp_pm_configure(&pm_config);
+    if (pm_err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep not enabled: %s", esp_err_to_name(pm_err));
+    }
+#endif
     
     ESP_LOGI(TAG, "System initialization complete, starting operation");
 }
@@ -9,23 +9,38 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_heap_caps.h"
 #include "driver/gpio.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali_scheme.h"
 #include "esp_http_server.h"
 #include "esp_http_client.h"
 #include "cJSON.h"
 #include "led_strip.h"
 #include "esp_crt_bundle.h"
+#include "esp_pm.h"
+#include "auto_light.h"
+#include "adc_filter.h"
+#include "light_cal.h"
+#include "seqlock.h"
+#include "json_writer.h"
+#include "telemetry_ring.h"
+#include "telemetry_push.h"
+#include "ws_clients.h"
+#include "led_effects.h"
 #include <time.h>
 #include <sys/time.h>
 
@@ -37,36 +52,172 @@
 #define WIFI_SSID      "4THU_Z95XZQ_2.4Ghz"        // WiFi Name (SSID)
 #define WIFI_PASS      "3n6xhs3z8p8f"            // WiFi Password
 #define WIFI_MAXIMUM_RETRY  5                // WiFi Connection Retry Count
+#define WIFI_RETRY_MIN_MS   10000   // Then keep retrying, backing off from 10 s
+#define WIFI_RETRY_MAX_MS   300000  // to 5 minutes between attempts
 
 // Data Push Configuration - Comment out PUSH_URL if not needed
 #define PUSH_URL       "https://myedu.webn.cc/api/sensor-data.php"  // Data Push Server Address
 #define PUSH_INTERVAL  60000                 // Push Interval (ms), 60000 = 1 minute
 #define DEVICE_ID      "ESP32_SMART_LIGHT_001"  // Unique Device ID
 
+// Telemetry: a sample every TELEMETRY_SAMPLE_MS, plus every PIR edge and
+// light/mode switch, goes into a ring (see telemetry_ring.h) that each
+// push drains in POSTs of up to TELEMETRY_BATCH_MAX records (telemetry_push.h)
+#define TELEMETRY_SAMPLE_MS     10000
+
+// Batch encoding: JSON, or with TELEMETRY_CBOR the delta-packed CBOR of
+// telemetry_cbor.h (about a tenth of the size). A server that answers
+// 415 Unsupported Media Type to CBOR gets JSON from then on.
+#ifndef TELEMETRY_CBOR
+#define TELEMETRY_CBOR          0
+#endif
+
+// Store-and-forward: records the server could not take are kept in the
+// "spool" data partition (partitions.csv: spool, data, 0x40, , 128K) and
+// sent, oldest first, at most SPOOL_DRAIN_BATCHES POSTs per push with
+// SPOOL_DRAIN_GAP_MS between them.
+#define SPOOL_PARTITION_LABEL   "spool"
+#define SPOOL_DRAIN_BATCHES     4
+#define SPOOL_DRAIN_GAP_MS      1000
+
+// Uploader: pushes run on their own task below the sampler and the
+// control task, so a slow or timed-out POST never holds up sensing or
+// auto mode. The push timer only queues a request; if the uploader is
+// still stuck on an earlier one, the request is dropped (the records
+// wait in the ring either way).
+#define UPLOAD_QUEUE_LEN        2
+#define UPLOAD_TASK_PRIORITY    2
+
 // ============================================================
 // The following configurations usually do not need modification
 // ============================================================
 
 // GPIO Pin Definitions
 #define PIR_SENSOR_PIN      GPIO_NUM_13
-#define LIGHT_SENSOR_PIN    ADC1_CHANNEL_6
+#define LIGHT_SENSOR_PIN    ADC_CHANNEL_6  // GPIO34 (ADC1_CH6)
 #define WS2812_PIN          GPIO_NUM_12
 
-// WS2812 Configuration
+// WS2812 Outputs: one logical strip can be wired as up to 4 runs, each on
+// its own GPIO and RMT channel, which transmit at the same time. The
+// pixels are split in order: the first run gets the first
+// length / LED_OUTPUTS pixels, and so on. WS2812_PIN is the first run.
+#ifndef LED_OUTPUTS
+#define LED_OUTPUTS         1
+#endif
+#define LED_OUTPUT_PINS     { WS2812_PIN, GPIO_NUM_14, GPIO_NUM_27, GPIO_NUM_26 }
+#if LED_OUTPUTS < 1 || LED_OUTPUTS > 4
+#error "LED_OUTPUTS must be 1 to 4 (RMT TX channels)"
+#endif
+
+// WS2812 Configuration: the strip length is set at runtime (/control
+// set_strip_length) and kept in NVS; LED_STRIP_LENGTH is the default.
+// LED_FRAME_PSRAM puts the frame buffers in PSRAM when the board has it.
 #define LED_STRIP_LENGTH    5
+#define LED_STRIP_MAX_LENGTH  2000
 #define LED_STRIP_RMT_RES_HZ  (10 * 1000 * 1000)
+#define LED_NVS_NAMESPACE   "smartlight"
+#define LED_NVS_KEY_LENGTH  "strip_len"
+#define LED_NVS_KEY_FPS     "render_fps"
+#ifndef LED_FRAME_PSRAM
+#define LED_FRAME_PSRAM     0
+#endif
+
+// Frame rate of animated effects: RENDER_FPS until /control set_fps
+// changes it (kept in NVS). Frames are timed by a periodic esp_timer, so
+// the rate is exact and independent of the 10 ms FreeRTOS tick.
+#ifndef RENDER_FPS
+#define RENDER_FPS          50
+#endif
+#define RENDER_FPS_MAX      100
+
+// Fades: set_color and set_brightness take LED_TRANSITION_MS unless the
+// command gives "transition_ms"; on and off are instant unless it does.
+// With EFFECT_FADE selected every change, automatic ones included, takes
+// at least LED_FADE_MS.
+#ifndef LED_TRANSITION_MS
+#define LED_TRANSITION_MS   300
+#endif
+#define LED_FADE_MS         1000
+#define LED_TRANSITION_MAX_MS  60000
+
+// Temporal dithering of dim pixels (see led_effects.h). A dim static
+// light then keeps the renderer at the full frame rate instead of idle.
+#ifndef LED_DITHER
+#define LED_DITHER          1
+#endif
+
+// Supply current the strip may draw (see the model in led_effects.h);
+// brighter frames are scaled down to it as they go out. 4 A lights a
+// LED_STRIP_MAX_LENGTH strip at the LED_MA_LIT_MIN floor below.
+#ifndef LED_POWER_BUDGET_MA
+#define LED_POWER_BUDGET_MA 4000
+#endif
+
+// Longest strip the budget can light at a useful level: every pixel keeps
+// LED_MA_LIT_MIN for light on top of its idle current (1 mA is about PWM 4
+// on each channel of white). Past it frames are scaled nearly to black.
+#define LED_MA_LIT_MIN      1
+#define LED_STRIP_LIT_MAX   (LED_POWER_BUDGET_MA / (LED_MA_IDLE + LED_MA_LIT_MIN))
+#define LED_STRIP_LENGTH_LIMIT \
+    ((LED_STRIP_LIT_MAX < LED_STRIP_MAX_LENGTH) ? LED_STRIP_LIT_MAX : LED_STRIP_MAX_LENGTH)
+_Static_assert(LED_STRIP_LENGTH <= LED_STRIP_LIT_MAX, "LED_POWER_BUDGET_MA cannot light the default strip");
 
 // Light Threshold
 #define LIGHT_THRESHOLD     3000
 
-// Light Effect Definitions
-typedef enum {
-    EFFECT_NONE = 0,
-    EFFECT_FADE,
-    EFFECT_BREATH,
-    EFFECT_RAINBOW,
-    EFFECT_RAINBOW_CYCLE
-} light_effect_t;
+// Auto Mode Switching (see auto_light.h): once dark, it only counts as
+// bright again LIGHT_HYSTERESIS past the threshold. Timings are in ms.
+#ifndef LIGHT_HYSTERESIS
+#define LIGHT_HYSTERESIS    200
+#endif
+#ifndef MOTION_HOLD_MS
+#define MOTION_HOLD_MS      30000
+#endif
+#ifndef MIN_ON_MS
+#define MIN_ON_MS           5000
+#endif
+#ifndef MIN_OFF_MS
+#define MIN_OFF_MS          2000
+#endif
+
+// PIR Handling: 1 = edge interrupt posts motion events immediately,
+// 0 = PIR level is polled by the sensor sampler
+#ifndef PIR_USE_INTERRUPT
+#define PIR_USE_INTERRUPT   1
+#endif
+
+// Sensor Sampling Period (ms): the light sensor is read off the control
+// task and only threshold crossings are forwarded to it. Without the PIR
+// interrupt the PIR is polled here too, at the old loop period.
+#if PIR_USE_INTERRUPT
+#define SENSOR_SAMPLE_PERIOD_MS 1000
+#else
+#define SENSOR_SAMPLE_PERIOD_MS 500
+#endif
+
+// Light Sensor Sampling: each period converts one burst of
+// LIGHT_ADC_BLOCK samples by DMA (continuous mode) and reduces it to one
+// reading with LIGHT_FILTER. The converter is stopped between bursts.
+#define LIGHT_ADC_SAMPLE_HZ     20000   // Lowest continuous-mode rate on the ESP32
+#define LIGHT_ADC_BLOCK         64      // Samples per burst (3.2 ms)
+#define LIGHT_ADC_TIMEOUT_MS    20
+#ifndef LIGHT_FILTER
+#define LIGHT_FILTER            ADC_FILTER_MOVING_AVG()
+#endif
+
+// Light Sensor Divider (see light_cal.h): GL5528-type LDR and a 10k
+// resistor across 3.3V, LDR on the GND side
+#define LDR_FIXED_OHMS          10000
+#define LDR_R10_OHMS            15000   // LDR resistance at 10 lux
+#define LDR_GAMMA               0.7f
+#define ADC_DEFAULT_VREF        1100    // Used when eFuse holds no Vref
+
+// Light Sleep between events (needs CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE). Off by default: GPIO edges are not
+// latched while asleep, so motion would only be seen on the next sample.
+#ifndef CTRL_LIGHT_SLEEP
+#define CTRL_LIGHT_SLEEP    0
+#endif
 
 static const char *TAG = "SmartLight";
 
@@ -74,7 +225,10 @@ static const char *TAG = "SmartLight";
 typedef struct {
     bool is_auto_mode;
     bool is_light_on;
-    int light_value;
+    int light_value;        // Filtered raw reading
+    int light_mv;           // Calibrated (see light_cal.h)
+    int light_lux;
+    int light_percent;      // 0 = darkest, 100 = brightest
     bool motion_detected;
     uint8_t red;
     uint8_t green;
@@ -82,6 +236,11 @@ typedef struct {
     uint8_t brightness;
     light_effect_t effect;
     uint16_t effect_speed;
+    uint16_t strip_length;
+    uint8_t render_fps;         // Frame clock ceiling
+    uint16_t transition_ms;     // Fade time of the latest light change
+    uint8_t segment_count;      // Zones drawn over the base effect (see segments)
+    uint16_t segments_gen;      // Bumped by every segment edit
 } system_state_t;
 
 static system_state_t system_state = {
@@ -94,36 +253,181 @@ static system_state_t system_state = {
     .blue = 255,
     .brightness = 100,
     .effect = EFFECT_NONE,
-    .effect_speed = 50
+    .effect_speed = 50,
+    .strip_length = LED_STRIP_LENGTH,
+    .render_fps = RENDER_FPS
 };
 
-static led_strip_handle_t led_strip = NULL;
+// system_state Access: the control task (and the sampler, for the light
+// fields) update it between state_write_begin/end; everyone else takes a
+// consistent copy with state_snapshot() (see seqlock.h)
+static seqlock_t system_state_seq = SEQLOCK_INIT;
+static portMUX_TYPE system_state_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void state_write_begin(void)
+{
+    taskENTER_CRITICAL(&system_state_mux);
+    seqlock_write_begin(&system_state_seq);
+}
+
+static void status_push_kick(void);
+static void status_push_light(int raw);
+
+// Ends an update without waking the status push (see set_light_reading)
+static inline void state_write_end_nopush(void)
+{
+    seqlock_write_end(&system_state_seq);
+    taskEXIT_CRITICAL(&system_state_mux);
+}
+
+static inline void state_write_end(void)
+{
+    state_write_end_nopush();
+    status_push_kick();
+}
+
+static void state_snapshot(system_state_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&system_state_seq);
+        *out = system_state;
+    } while (seqlock_read_retry(&system_state_seq, seq));
+}
+
+// The segment table is edited under the same seqlock, but kept out of
+// system_state so that every snapshot does not copy it; the render task
+// copies it when segments_gen moves. Returns the generation copied.
+static led_segments_t segments;
+
+static uint16_t segments_snapshot(led_segments_t *out)
+{
+    uint32_t seq;
+    uint16_t gen;
+    do {
+        seq = seqlock_read_begin(&system_state_seq);
+        *out = segments;
+        gen = system_state.segments_gen;
+    } while (seqlock_read_retry(&system_state_seq, seq));
+    return gen;
+}
+
+static led_strip_handle_t led_strip[LED_OUTPUTS];
 static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
 
 static int s_retry_num = 0;
 static httpd_handle_t server = NULL;
-static esp_adc_cal_characteristics_t *adc_chars;
+
+// Light Sensor ADC (continuous mode) and its block filter
+static adc_continuous_handle_t light_adc = NULL;
+static adc_filter_t light_filter = LIGHT_FILTER;
+
+// Light Sensor Calibration: raw -> mV / lux / percent table, built at boot
+static const light_cal_config_t light_cal_cfg = {
+    .vcc_mv = 3300,
+    .fixed_ohms = LDR_FIXED_OHMS,
+    .ldr_r10_ohms = LDR_R10_OHMS,
+    .ldr_gamma = LDR_GAMMA,
+    .ldr_to_gnd = true,
+};
+static light_cal_t light_cal;
+
+// Control Events: everything that can change the light goes through
+// one queue, so the control task is the only writer of the outputs
+typedef enum {
+    CTRL_EVT_PIR_EDGE,          // PIR level changed
+    CTRL_EVT_LIGHT_CROSS,       // Light reading went dark or bright
+    CTRL_EVT_AUTO_TIMER,        // Motion hold-off or dwell time ran out
+    CTRL_EVT_CMD_ON,            // HTTP /control actions
+    CTRL_EVT_CMD_OFF,
+    CTRL_EVT_CMD_TOGGLE_MODE,
+    CTRL_EVT_CMD_SET_COLOR,     // value: 0xRRGGBB
+    CTRL_EVT_CMD_SET_BRIGHTNESS,
+    CTRL_EVT_CMD_SET_EFFECT,
+    CTRL_EVT_CMD_SET_LENGTH,    // value: pixels
+    CTRL_EVT_CMD_SET_FPS,       // value: frames per second
+    CTRL_EVT_CMD_SET_SEGMENT,   // value: segment_cmd slot, added or replaced by name
+    CTRL_EVT_CMD_DELETE_SEGMENT,    // value: segment_cmd slot, by name
+} ctrl_event_type_t;
+
+typedef struct {
+    ctrl_event_type_t type;
+    int64_t at_us;          // esp_timer time the event was raised
+    int value;              // Event argument (reading, on/off, ...)
+    int transition_ms;      // Light commands: fade time, -1 for the default
+} ctrl_event_t;
+
+#define CTRL_EVT_QUEUE_LEN  16
+static QueueHandle_t ctrl_evt_queue = NULL;
+
+// Segment commands are too big for every event to carry: the HTTP
+// server (their only sender) fills the next slot and posts its index as
+// the value. Queued events plus the one being applied plus the one being
+// filled never exceed the slots, so a slot is not refilled while in use.
+#define SEGMENT_CMD_SLOTS   (CTRL_EVT_QUEUE_LEN + 2)
+static led_segment_t segment_cmd[SEGMENT_CMD_SLOTS];
+static uint8_t segment_cmd_next = 0;
+
+// Worst time an event waited in the queue since the last push report
+static volatile uint32_t ctrl_worst_pickup_us = 0;
+
+typedef struct {
+    int64_t at_us;          // esp_timer time the push was due
+} upload_req_t;
+
+static QueueHandle_t upload_queue = NULL;
+static TaskHandle_t render_task_handle = NULL;
+
+// Auto Mode State Machine
+// Dark = high ADC value (LDR to GND)
+static const auto_light_config_t auto_light_cfg = {
+    .dark_threshold = LIGHT_THRESHOLD,
+    .bright_threshold = LIGHT_THRESHOLD - LIGHT_HYSTERESIS,
+    .dark_is_high = true,
+    .motion_hold_ms = MOTION_HOLD_MS,
+    .min_on_ms = MIN_ON_MS,
+    .min_off_ms = MIN_OFF_MS,
+};
+static auto_light_t auto_light;
+static esp_timer_handle_t auto_light_timer = NULL;
 
 // WiFi Event Handler
+// WiFi Reconnect: once the quick retries are used up, keep trying on a
+// backoff timer instead of staying offline until the next reboot
+static esp_timer_handle_t wifi_retry_timer = NULL;
+static uint32_t wifi_retry_ms = WIFI_RETRY_MIN_MS;
+
+static void wifi_retry_cb(void *arg)
+{
+    ESP_LOGI(TAG, "Retrying WiFi connection...");
+    esp_wifi_connect();
+}
+
 static void event_handler(void* arg, esp_event_base_t event_base,
                           int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         if (s_retry_num < WIFI_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
             ESP_LOGI(TAG, "Retrying WiFi connection...");
         } else {
             xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+            ESP_LOGW(TAG, "WiFi unavailable, next attempt in %lu s", (unsigned long)(wifi_retry_ms / 1000));
+            esp_timer_start_once(wifi_retry_timer, (uint64_t)wifi_retry_ms * 1000);
+            wifi_retry_ms = (wifi_retry_ms * 2 < WIFI_RETRY_MAX_MS) ? wifi_retry_ms * 2 : WIFI_RETRY_MAX_MS;
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "Got IP:" IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        wifi_retry_ms = WIFI_RETRY_MIN_MS;
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -132,6 +436,11 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 void wifi_init_sta(void)
 {
     s_wifi_event_group = xEventGroupCreate();
+    const esp_timer_create_args_t retry_args = {
+        .callback = wifi_retry_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_args, &wifi_retry_timer));
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     esp_netif_create_default_wifi_sta();
@@ -157,231 +466,691 @@ void wifi_init_sta(void)
                         pdFALSE, pdFALSE, portMAX_DELAY);
 }
 
-// HTTP Event Handler
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                printf("%.*s", evt->data_len, (char*)evt->data);
-            }
-            break;
-        default:
-            break;
-    }
-    return ESP_OK;
-}
+// Telemetry Ring: filled by the sensor and control tasks, drained by the push
+static telemetry_ring_t telemetry;
+static portMUX_TYPE telemetry_mux = portMUX_INITIALIZER_UNLOCKED;
 
-// Push Data
-void push_sensor_data(void)
+// Append a timestamped copy of the current state
+static void telemetry_record(telemetry_kind_t kind)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        ESP_LOGE(TAG, "Failed to create JSON object");
-        return;
-    }
-    
-    // Add Device Info (Use field names expected by the server)
-    cJSON_AddStringToObject(root, "deviceId", DEVICE_ID);
-    
-    // Add Timestamp
+    system_state_t state;
+    state_snapshot(&state);
     struct timeval tv;
     gettimeofday(&tv, NULL);
-    cJSON_AddNumberToObject(root, "timestamp", tv.tv_sec);
-    
-    // Add Sensor Data
-    cJSON_AddNumberToObject(root, "lightValue", system_state.light_value);
-    
-    // Calculate light percentage (Note: Adjust based on your LDR wiring)
-    // If strong light = low ADC, weak light = high ADC, use inverted logic
-    int light_percent = (int)((1.0 - (float)system_state.light_value / 4095.0) * 100);
-    cJSON_AddNumberToObject(root, "lightPercent", light_percent);
-    
-    cJSON_AddBoolToObject(root, "motion", system_state.motion_detected);
-    cJSON_AddBoolToObject(root, "lightOn", system_state.is_light_on);
-    cJSON_AddBoolToObject(root, "autoMode", system_state.is_auto_mode);
+    telemetry_record_t rec = {
+        .t_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000,
+        .light_value = (uint16_t)state.light_value,
+        .light_mv = (uint16_t)state.light_mv,
+        .light_lux = (uint16_t)state.light_lux,
+        .light_percent = (uint8_t)state.light_percent,
+        .kind = (uint8_t)kind,
+        .motion = state.motion_detected,
+        .light_on = state.is_light_on,
+        .auto_mode = state.is_auto_mode,
+    };
+    taskENTER_CRITICAL(&telemetry_mux);
+    telemetry_ring_put(&telemetry, &rec);
+    taskEXIT_CRITICAL(&telemetry_mux);
+}
+
+// Batch payload: {"deviceId":...,"records":[...]}. Each record has the
+// fields of the old single-sample push, plus "event" and the sub-second
+// part of its timestamp in "ms".
+static size_t telemetry_batch_json(char *buf, size_t cap, const telemetry_record_t *rec, uint32_t n)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, cap);
+    json_obj_begin(&w, NULL);
+    json_add_str(&w, "deviceId", DEVICE_ID);
     
     // WS2812 Specific Data (Optional, server side does not verify)
-    cJSON_AddNumberToObject(root, "red", system_state.red);
-    cJSON_AddNumberToObject(root, "green", system_state.green);
-    cJSON_AddNumberToObject(root, "blue", system_state.blue);
-    cJSON_AddNumberToObject(root, "brightness", system_state.brightness);
-    
-    char *json_str = cJSON_Print(root);
-    if (json_str == NULL) {
-        ESP_LOGE(TAG, "JSON Serialization Failed");
-        cJSON_Delete(root);
-        return;
+    system_state_t state;
+    state_snapshot(&state);
+    json_add_int(&w, "red", state.red);
+    json_add_int(&w, "green", state.green);
+    json_add_int(&w, "blue", state.blue);
+    json_add_int(&w, "brightness", state.brightness);
+    json_arr_begin(&w, "records");
+    for (uint32_t i = 0; i < n; i++) {
+        json_obj_begin(&w, NULL);
+        json_add_int(&w, "timestamp", (int32_t)(rec[i].t_ms / 1000));
+        json_add_int(&w, "ms", (int32_t)(rec[i].t_ms % 1000));
+        json_add_str(&w, "event", telemetry_kind_name(rec[i].kind));
+        json_add_int(&w, "lightValue", rec[i].light_value);
+        json_add_int(&w, "lightPercent", rec[i].light_percent);
+        json_add_int(&w, "lightMv", rec[i].light_mv);
+        json_add_int(&w, "lux", rec[i].light_lux);
+        json_add_bool(&w, "motion", rec[i].motion);
+        json_add_bool(&w, "lightOn", rec[i].light_on);
+        json_add_bool(&w, "autoMode", rec[i].auto_mode);
+        json_obj_end(&w);
     }
-    
-    ESP_LOGI(TAG, "Preparing to push data: %s", json_str);
-    
-    esp_http_client_config_t config = {
+    json_arr_end(&w);
+    json_obj_end(&w);
+    return json_writer_ok(&w) ? w.len : 0;
+}
+
+// CBOR batches carry the strip colour at the time of the push
+static void telemetry_batch_color(uint8_t color[4])
+{
+    system_state_t state;
+    state_snapshot(&state);
+    color[0] = state.red;
+    color[1] = state.green;
+    color[2] = state.blue;
+    color[3] = state.brightness;
+}
+
+// Telemetry Client: kept for the life of the firmware, so pushes reuse
+// the HTTPS connection instead of paying a full TLS handshake each time,
+// and resume the TLS session when the server has closed it (needs
+// CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+static const telemetry_push_config_t uploader_config = {
+    .tag = "SmartLight",
+    .device_id = DEVICE_ID,
+    .http = {
         .url = PUSH_URL,
-        .event_handler = http_event_handler,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 5000,
         .transport_type = HTTP_TRANSPORT_OVER_SSL,
         .crt_bundle_attach = esp_crt_bundle_attach,
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "HTTP Client Initialization Failed");
-        free(json_str);
-        cJSON_Delete(root);
-        return;
-    }
-    
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_str, strlen(json_str));
-    esp_err_t err = esp_http_client_perform(client);
-    
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        int content_length = esp_http_client_get_content_length(client);
-        ESP_LOGI(TAG, "Data Push Success - HTTP Status=%d, Length=%d", 
-                 status_code, content_length);
-    } else {
-        ESP_LOGE(TAG, "Data Push Failed: %s", esp_err_to_name(err));
-    }
-    
-    esp_http_client_cleanup(client);
-    free(json_str);
-    cJSON_Delete(root);
+        .save_client_session = true,    // Resume TLS on reconnect
+    },
+    .cbor = TELEMETRY_CBOR,
+    .ring = &telemetry,
+    .ring_mux = &telemetry_mux,
+    .spool_label = SPOOL_PARTITION_LABEL,
+    .drain_batches = SPOOL_DRAIN_BATCHES,
+    .drain_gap_ms = SPOOL_DRAIN_GAP_MS,
+    .batch_json = telemetry_batch_json,
+    .batch_color = telemetry_batch_color,
+};
+
+// Owned by the uploader task, like the spool it holds
+static telemetry_push_t uploader;
+
+// Push Sensor Data to Server (see telemetry_push_run)
+void push_sensor_data(void)
+{
+    bool online = (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+    telemetry_push_run(&uploader, online);
 }
 
-// WS2812 Control Functions
-void apply_brightness(uint8_t *r, uint8_t *g, uint8_t *b)
+// Frame Renderer: the render task is the only user of led_strip.
+// Commands and effects only change system_state; each frame is drawn from
+// one snapshot into the back buffer, and only if it differs from the
+// frame on the strip is it sent, after which the buffers swap. Animated
+// effects run on the frame clock; a static light is drawn once, then the
+// task sleeps until the control task notifies it. Effect math is integer
+// only (see led_effects.h); gamma is applied as pixels go out. A new
+// strip length re-creates the strip and both buffers from the render task.
+// The frame is one buffer however many outputs carry it; output o shows
+// pixels out_start[o] up to out_start[o + 1].
+static grb_t *frame_buf[2];
+static uint16_t frame_len = 0;
+static uint8_t frame_front = 0;     // Buffer the strip is showing
+static uint8_t out_count = 0;       // Outputs in use (never more than pixels)
+static uint16_t out_start[LED_OUTPUTS + 1];
+static uint8_t dither_phase = 0;
+static bool frame_dithered = false; // Front frame differs by phase
+static volatile uint32_t power_ma = 0;  // Estimated draw of the front frame
+static volatile uint32_t compose_us_last = 0;
+static volatile uint32_t compose_us_max = 0;   // Worst time to draw one frame
+
+static void frame_buf_free(void)
 {
-    *r = (*r * system_state.brightness) / 100;
-    *g = (*g * system_state.brightness) / 100;
-    *b = (*b * system_state.brightness) / 100;
+    for (int i = 0; i < 2; i++) {
+        heap_caps_free(frame_buf[i]);
+        frame_buf[i] = NULL;
+    }
 }
 
-void set_all_leds(uint8_t r, uint8_t g, uint8_t b)
+static grb_t *frame_buf_alloc(uint16_t len)
 {
-    apply_brightness(&r, &g, &b);
-    for (int i = 0; i < LED_STRIP_LENGTH; i++) {
-        led_strip_set_pixel(led_strip, i, r, g, b);
+    grb_t *buf = NULL;
+    if (LED_FRAME_PSRAM) {
+        buf = heap_caps_calloc(len, sizeof(grb_t), MALLOC_CAP_SPIRAM);
+    }
+    if (buf == NULL) {
+        buf = heap_caps_calloc(len, sizeof(grb_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     }
-    led_strip_refresh(led_strip);
+    return buf;
 }
 
-void clear_all_leds(void)
+static void strip_close(void)
 {
-    led_strip_clear(led_strip);
+    for (int o = 0; o < out_count; o++) {
+        led_strip_clear(led_strip[o]);
+        led_strip_del(led_strip[o]);
+        led_strip[o] = NULL;
+    }
+    out_count = 0;
+    frame_buf_free();
+    frame_len = 0;
+    frame_front = 0;
+    frame_dithered = false;
+    power_ma = 0;
 }
 
-void hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+// (Re)create the strip drivers and both frames for len pixels, all dark
+static esp_err_t strip_open(uint16_t len)
 {
-    if (s == 0) {
-        *r = v; *g = v; *b = v;
-        return;
+    static const gpio_num_t pins[] = LED_OUTPUT_PINS;
+    strip_close();
+    
+    frame_buf[0] = frame_buf_alloc(len);
+    frame_buf[1] = frame_buf_alloc(len);
+    if (frame_buf[0] == NULL || frame_buf[1] == NULL) {
+        frame_buf_free();
+        return ESP_ERR_NO_MEM;
     }
     
-    uint8_t region = h / 43;
-    uint8_t remainder = (h - (region * 43)) * 6;
-    uint8_t p = (v * (255 - s)) >> 8;
-    uint8_t q = (v * (255 - ((s * remainder) >> 8))) >> 8;
-    uint8_t t = (v * (255 - ((s * (255 - remainder)) >> 8))) >> 8;
+    uint8_t outputs = (len < LED_OUTPUTS) ? len : LED_OUTPUTS;
+    for (int o = 0; o <= outputs; o++) {
+        out_start[o] = (uint16_t)((uint32_t)len * o / outputs);
+    }
+    for (int o = 0; o < outputs; o++) {
+        led_strip_config_t strip_config = {
+            .strip_gpio_num = pins[o],
+            .max_leds = out_start[o + 1] - out_start[o],
+            .led_pixel_format = LED_PIXEL_FORMAT_GRB,
+            .led_model = LED_MODEL_WS2812,
+            .flags.invert_out = false,
+        };
+        led_strip_rmt_config_t rmt_config = {
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .resolution_hz = LED_STRIP_RMT_RES_HZ,
+            .flags.with_dma = false,
+        };
+        esp_err_t err = led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip[o]);
+        if (err != ESP_OK) {
+            strip_close();
+            return err;
+        }
+        out_count = o + 1;
+        led_strip_clear(led_strip[o]);
+    }
+    frame_len = len;
+    ESP_LOGI(TAG, "LED strip: %u pixels on %u output(s), %u bytes per frame",
+             len, out_count, (unsigned)(len * sizeof(grb_t)));
+    return ESP_OK;
+}
+
+// Strip settings kept in NVS: a missing or out of range value reads as
+// the default
+static uint16_t led_setting_load(const char *key, uint16_t dflt, uint16_t max)
+{
+    nvs_handle_t nvs;
+    uint16_t value = dflt;
+    if (nvs_open(LED_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        if (nvs_get_u16(nvs, key, &value) != ESP_OK || value == 0 || value > max) {
+            value = dflt;
+        }
+        nvs_close(nvs);
+    }
+    return value;
+}
 
-    switch (region) {
-        case 0: *r = v; *g = t; *b = p; break;
-        case 1: *r = q; *g = v; *b = p; break;
-        case 2: *r = p; *g = v; *b = t; break;
-        case 3: *r = p; *g = q; *b = v; break;
-        case 4: *r = t; *g = p; *b = v; break;
-        default: *r = v; *g = p; *b = q; break;
+static void led_setting_save(const char *key, uint16_t value)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(LED_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_u16(nvs, key, value);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Setting %s not saved: %s", key, esp_err_to_name(err));
     }
 }
 
+// Fade time for the look changes of the event being applied (see
+// set_light_fade). Each setter stores it in the same write as the change
+// it belongs to, so an unrelated event handled before the render task
+// takes its snapshot cannot turn a fade into a jump.
+static uint16_t light_fade_ms = 0;
+
+void set_light_fade(int ms)
+{
+    if (ms < 0) ms = 0;
+    if (ms > LED_TRANSITION_MAX_MS) ms = LED_TRANSITION_MAX_MS;
+    light_fade_ms = (uint16_t)ms;
+}
+
 void turn_on_light(void)
 {
-    set_all_leds(system_state.red, system_state.green, system_state.blue);
+    bool changed = (system_state.is_light_on != true);
+    state_write_begin();
     system_state.is_light_on = true;
+    if (changed) {
+        system_state.transition_ms = light_fade_ms;
+    }
+    state_write_end();
+    if (changed) {
+        telemetry_record(TELEMETRY_LIGHT);
+    }
+    auto_light_note_switch(&auto_light, true, esp_timer_get_time());
     ESP_LOGI(TAG, "Light Turned ON RGB(%d,%d,%d)", system_state.red, system_state.green, system_state.blue);
 }
 
 void turn_off_light(void)
 {
-    clear_all_leds();
+    bool changed = (system_state.is_light_on != false);
+    state_write_begin();
     system_state.is_light_on = false;
+    if (changed) {
+        system_state.transition_ms = light_fade_ms;
+    }
+    state_write_end();
+    if (changed) {
+        telemetry_record(TELEMETRY_LIGHT);
+    }
+    auto_light_note_switch(&auto_light, false, esp_timer_get_time());
     ESP_LOGI(TAG, "Light Turned OFF");
 }
 
 void set_rgb_color(uint8_t r, uint8_t g, uint8_t b)
 {
+    if (r == system_state.red && g == system_state.green && b == system_state.blue) {
+        return;
+    }
+    state_write_begin();
     system_state.red = r;
     system_state.green = g;
     system_state.blue = b;
-    if (system_state.is_light_on) {
-        set_all_leds(r, g, b);
-    }
+    system_state.transition_ms = light_fade_ms;
+    state_write_end();
 }
 
 void set_brightness(uint8_t brightness)
 {
     if (brightness > 100) brightness = 100;
+    if (brightness == system_state.brightness) {
+        return;
+    }
+    state_write_begin();
     system_state.brightness = brightness;
-    if (system_state.is_light_on) {
-        set_all_leds(system_state.red, system_state.green, system_state.blue);
+    system_state.transition_ms = light_fade_ms;
+    state_write_end();
+}
+
+// Unknown effects are rejected by /control; a new effect starts at its
+// default speed
+void set_effect(light_effect_t effect)
+{
+    const led_effect_desc_t *fx = led_effect_get(effect);
+    if (fx == NULL) {
+        ESP_LOGW(TAG, "Unknown effect %d", effect);
+        return;
+    }
+    state_write_begin();
+    if (system_state.effect != effect) {
+        system_state.effect_speed = fx->default_speed;
+    }
+    system_state.effect = effect;
+    state_write_end();
+}
+
+// Back to a plain colour; EFFECT_FADE is one already and stays selected
+static void set_solid(void)
+{
+    if (system_state.effect != EFFECT_FADE) {
+        set_effect(EFFECT_NONE);
+    }
+}
+
+// The render task re-creates the strip at the new length
+void set_strip_length(int len)
+{
+    if (len < 1 || len > LED_STRIP_LENGTH_LIMIT) {
+        ESP_LOGW(TAG, "Strip length %d out of range (1..%d, %d mA budget)", len,
+                 LED_STRIP_LENGTH_LIMIT, LED_POWER_BUDGET_MA);
+        return;
+    }
+    if (len == system_state.strip_length) {
+        return;
+    }
+    state_write_begin();
+    system_state.strip_length = (uint16_t)len;
+    state_write_end();
+    led_setting_save(LED_NVS_KEY_LENGTH, (uint16_t)len);
+}
+
+// Ceiling of the frame clock; effects that declare less run slower
+void set_render_fps(int fps)
+{
+    if (fps < 1 || fps > RENDER_FPS_MAX) {
+        ESP_LOGW(TAG, "Frame rate %d out of range (1..%d)", fps, RENDER_FPS_MAX);
+        return;
+    }
+    if (fps == system_state.render_fps) {
+        return;
+    }
+    state_write_begin();
+    system_state.render_fps = (uint8_t)fps;
+    state_write_end();
+    led_setting_save(LED_NVS_KEY_FPS, (uint16_t)fps);
+}
+
+void set_segment(const led_segment_t *seg)
+{
+    if (seg->name[0] == '\0' || seg->len == 0 || seg->start + seg->len > LED_STRIP_LENGTH_LIMIT ||
+        led_effect_get(seg->effect) == NULL) {
+        ESP_LOGW(TAG, "Segment \"%s\" rejected (%u+%u, effect %u)",
+                 seg->name, seg->start, seg->len, seg->effect);
+        return;
+    }
+    state_write_begin();
+    bool stored = led_segment_put(&segments, seg);
+    system_state.segment_count = segments.count;
+    system_state.segments_gen++;
+    state_write_end();
+    if (!stored) {
+        ESP_LOGW(TAG, "Segment \"%s\" rejected, all %d in use", seg->name, LED_SEGMENT_MAX);
+    }
+}
+
+void delete_segment(const char *name)
+{
+    state_write_begin();
+    if (led_segment_remove(&segments, name)) {
+        system_state.segment_count = segments.count;
+        system_state.segments_gen++;
+    }
+    state_write_end();
+}
+
+static led_segment_t state_base(const system_state_t *s, rgb_t color)
+{
+    return (led_segment_t){
+        .effect = s->effect,
+        .brightness = 100,
+        .speed = (uint8_t)((s->effect_speed < 100) ? s->effect_speed : 99),
+        .color = color,
+    };
+}
+
+// Frames per second the lit effects need (see led_effect_table); 0 when
+// the picture is static
+static uint8_t effect_fps(const system_state_t *s, const led_segments_t *set)
+{
+    if (!s->is_light_on) {
+        return 0;
+    }
+    const led_segment_t base = state_base(s, (rgb_t){ s->red, s->green, s->blue });
+    return led_compose_fps(frame_len, &base, set);
+}
+
+// Colour and level the state asks for; the renderer fades towards it
+static led_look_t state_look(const system_state_t *s)
+{
+    return (led_look_t){
+        .color = { s->red, s->green, s->blue },
+        .level = s->is_light_on ? led_percent_to_scale(s->brightness) : 0,
+    };
+}
+
+// Draw the state into a frame at the colour and level a fade has got to;
+// t_ms is the time the effect has run. The base colour and effect cover
+// the strip, segments are drawn over it, and the level scales them all.
+static void render_frame(grb_t *frame, const system_state_t *s, const led_segments_t *set,
+                         led_look_t look, uint32_t t_ms)
+{
+    if (look.level == 0) {
+        led_fx_fill(frame, frame_len, (rgb_t){ 0, 0, 0 });
+        return;
+    }
+    
+    const led_segment_t base = state_base(s, look.color);
+    led_compose(frame, frame_len, &base, set, look.level, t_ms);
+}
+
+// PWM value of one channel on the wire: gamma (dithered when enabled),
+// then the power limit
+static inline uint8_t frame_pwm(uint8_t v, uint8_t phase, bool *dithered, uint8_t limit)
+{
+#if LED_DITHER
+    uint8_t pwm = led_dither8(v, phase, dithered);
+#else
+    uint8_t pwm = led_gamma8[v];
+    (void)phase;
+    (void)dithered;
+#endif
+    return (limit == 255) ? pwm : scale8(pwm, limit);
+}
+
+// Send the back buffer if it changed (or a dithered frame needs its next
+// phase), then make it the front one. A frame that would draw more than
+// LED_POWER_BUDGET_MA is scaled down as a whole, so colours keep their
+// balance. Each output starts transmitting
+// as soon as its pixels are loaded, so the next one is filled while it
+// sends, and the frame takes the wire time of the longest run rather
+// than of the whole strip.
+static void frame_show(void)
+{
+    const grb_t *front = frame_buf[frame_front];
+    const grb_t *back = frame_buf[frame_front ^ 1];
+    if (!frame_dithered && memcmp(back, front, frame_len * sizeof(grb_t)) == 0) {
+        return;
+    }
+    uint32_t ma = led_power_ma(led_frame_pwm_sum(back, frame_len), frame_len);
+    uint8_t limit = led_power_scale(ma, frame_len, LED_POWER_BUDGET_MA);
+    if (limit < 255) {
+        uint32_t idle = frame_len * LED_MA_IDLE;
+        ma = idle + (ma - idle) * limit / 255;
+    }
+    power_ma = ma;
+    
+    bool dithered = false;
+    dither_phase++;
+    for (int o = 0; o < out_count; o++) {
+        const grb_t *px = back + out_start[o];
+        int n = out_start[o + 1] - out_start[o];
+        for (int i = 0; i < n; i++) {
+            uint8_t phase = (uint8_t)(dither_phase + out_start[o] + i);
+            led_strip_set_pixel(led_strip[o], i, frame_pwm(px[i].r, phase, &dithered, limit),
+                                frame_pwm(px[i].g, phase, &dithered, limit),
+                                frame_pwm(px[i].b, phase, &dithered, limit));
+        }
+        led_strip_refresh_async(led_strip[o]);
+    }
+    frame_dithered = dithered;
+    for (int o = 0; o < out_count; o++) {
+        led_strip_refresh_wait_done(led_strip[o]);
+    }
+    frame_front ^= 1;
+}
+
+// Frame clock: a periodic esp_timer sets RENDER_WAKE_FRAME on the render
+// task once per frame period, the control task sets RENDER_WAKE_CHANGE.
+// Frame n is due at clock_t0_us + n * clock_period_us; a frame that took
+// longer than its period skips the ticks it ran over (counted as missed)
+// instead of running behind, and how late each frame starts is its jitter.
+#define RENDER_WAKE_CHANGE  0x01
+#define RENDER_WAKE_FRAME   0x02
+
+typedef struct {
+    uint32_t fps;               // Clock rate (0 while idle)
+    uint32_t frames;            // Frames run on the clock
+    uint32_t missed;            // Ticks skipped by frames that ran over
+    uint32_t jitter_us;         // Start of the last frame after its tick
+    uint32_t jitter_us_max;
+    uint64_t jitter_us_sum;
+    uint32_t show_us;           // Time to send the last frame
+    uint32_t show_us_max;
+} render_diag_t;
+
+// Written by the render task only, between diag_write_begin/end; GET
+// /render copies it with diag_snapshot() (see seqlock.h), so the 64-bit
+// sum is never read half updated
+static render_diag_t render_diag;
+static seqlock_t render_diag_seq = SEQLOCK_INIT;
+static portMUX_TYPE render_diag_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void diag_write_begin(void)
+{
+    taskENTER_CRITICAL(&render_diag_mux);
+    seqlock_write_begin(&render_diag_seq);
+}
+
+static inline void diag_write_end(void)
+{
+    seqlock_write_end(&render_diag_seq);
+    taskEXIT_CRITICAL(&render_diag_mux);
+}
+
+static void diag_snapshot(render_diag_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&render_diag_seq);
+        *out = render_diag;
+    } while (seqlock_read_retry(&render_diag_seq, seq));
+}
+static esp_timer_handle_t frame_timer = NULL;
+static int64_t clock_t0_us = 0;
+static uint32_t clock_period_us = 0;
+static uint64_t clock_tick = 0;         // Tick the current frame runs on
+
+static void frame_timer_cb(void *arg)
+{
+    xTaskNotify((TaskHandle_t)arg, RENDER_WAKE_FRAME, eSetBits);
+}
+
+// Run the clock at fps, or stop it at 0; a new rate starts from now
+static void frame_clock_set(uint32_t fps)
+{
+    if (fps == render_diag.fps) {
+        return;
+    }
+    esp_timer_stop(frame_timer);
+    diag_write_begin();
+    render_diag.fps = fps;
+    diag_write_end();
+    if (fps == 0) {
+        return;
+    }
+    clock_period_us = 1000000 / fps;
+    clock_t0_us = esp_timer_get_time();
+    clock_tick = 0;
+    ESP_ERROR_CHECK(esp_timer_start_periodic(frame_timer, clock_period_us));
+}
+
+// Sleep until the next tick and return the clock time since the last
+// frame, in µs. Changes are picked up by the next frame anyway.
+static uint32_t frame_clock_wait(void)
+{
+    uint64_t tick = clock_tick;
+    int64_t now = 0;
+    while (tick <= clock_tick) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        if (bits & RENDER_WAKE_FRAME) {
+            // A tick that fired while the last frame was drawn or sent
+            // is late, not stale: the frame runs now
+            now = esp_timer_get_time();
+            tick = (uint64_t)(now - clock_t0_us) / clock_period_us;
+        }
+    }
+    
+    uint32_t late_us = (uint32_t)(now - clock_t0_us - (int64_t)(tick * clock_period_us));
+    diag_write_begin();
+    render_diag.frames++;
+    render_diag.missed += (uint32_t)(tick - clock_tick - 1);
+    render_diag.jitter_us = late_us;
+    render_diag.jitter_us_sum += late_us;
+    if (late_us > render_diag.jitter_us_max) {
+        render_diag.jitter_us_max = late_us;
     }
+    diag_write_end();
+    uint32_t elapsed_us = (uint32_t)(tick - clock_tick) * clock_period_us;
+    clock_tick = tick;
+    return elapsed_us;
 }
 
-// Light Effect Task
-void light_effect_task(void *pvParameters)
+// Render Task
+void render_task(void *pvParameters)
 {
-    uint16_t hue = 0;
-    float breath_phase = 0;
+    uint64_t effect_us = 0;
+    led_transition_t fade = { 0 };
+    static led_segments_t segs;     // Copy of the segment table
+    uint16_t segs_gen = segments_snapshot(&segs);
+    
+    const esp_timer_create_args_t clock_args = {
+        .callback = frame_timer_cb,
+        .arg = xTaskGetCurrentTaskHandle(),
+        .name = "frame_clock",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&clock_args, &frame_timer));
     
     while (1) {
-        if (system_state.is_light_on && system_state.effect != EFFECT_NONE) {
-            switch (system_state.effect) {
-                case EFFECT_RAINBOW: {
-                    uint8_t r, g, b;
-                    hsv_to_rgb(hue, 255, 255, &r, &g, &b);
-                    set_all_leds(r, g, b);
-                    hue = (hue + 1) % 256;
-                    vTaskDelay(pdMS_TO_TICKS(100 - system_state.effect_speed));
-                    break;
-                }
-                
-                case EFFECT_RAINBOW_CYCLE: {
-                    for (int i = 0; i < LED_STRIP_LENGTH; i++) {
-                        uint8_t r, g, b;
-                        uint16_t pixel_hue = (hue + (i * 256 / LED_STRIP_LENGTH)) % 256;
-                        hsv_to_rgb(pixel_hue, 255, 255, &r, &g, &b);
-                        apply_brightness(&r, &g, &b);
-                        led_strip_set_pixel(led_strip, i, r, g, b);
-                    }
-                    led_strip_refresh(led_strip);
-                    hue = (hue + 1) % 256;
-                    vTaskDelay(pdMS_TO_TICKS(100 - system_state.effect_speed));
-                    break;
-                }
-                
-                case EFFECT_BREATH: {
-                    breath_phase += 0.05;
-                    if (breath_phase >= 2 * M_PI) breath_phase = 0;
-                    float brightness_factor = (sin(breath_phase) + 1.0) / 2.0;
-                    uint8_t temp_brightness = system_state.brightness * brightness_factor;
-                    uint8_t r = (system_state.red * temp_brightness) / 100;
-                    uint8_t g = (system_state.green * temp_brightness) / 100;
-                    uint8_t b = (system_state.blue * temp_brightness) / 100;
-                    for (int i = 0; i < LED_STRIP_LENGTH; i++) {
-                        led_strip_set_pixel(led_strip, i, r, g, b);
-                    }
-                    led_strip_refresh(led_strip);
-                    vTaskDelay(pdMS_TO_TICKS(50));
-                    break;
-                }
-                
-                default:
-                    break;
+        // One consistent view per frame; the control task may change it
+        system_state_t state;
+        state_snapshot(&state);
+        if (state.segments_gen != segs_gen) {
+            segs_gen = segments_snapshot(&segs);
+        }
+        if (state.strip_length != frame_len) {
+            esp_err_t err = strip_open(state.strip_length);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "No room for %u pixels (%s), back to %d",
+                         state.strip_length, esp_err_to_name(err), LED_STRIP_LENGTH);
+                ESP_ERROR_CHECK(strip_open(LED_STRIP_LENGTH));
+                led_setting_save(LED_NVS_KEY_LENGTH, LED_STRIP_LENGTH);  // Or every boot retries it
+                state_write_begin();
+                system_state.strip_length = LED_STRIP_LENGTH;
+                state_write_end();
+                state.strip_length = LED_STRIP_LENGTH;
+            }
+        }
+        
+        // A new target fades from what is on the strip now, so commands
+        // arriving faster than frames just move the target
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        led_look_t target = state_look(&state);
+        if (!led_look_equal(target, fade.to)) {
+            uint32_t dur_ms = state.transition_ms;
+            if (state.effect == EFFECT_FADE && dur_ms < LED_FADE_MS) {
+                dur_ms = LED_FADE_MS;
+            }
+            led_transition_to(&fade, target, now_ms, dur_ms);
+        }
+        bool fading = led_transition_active(&fade, now_ms);
+        
+        if (frame_len > 0) {
+            int64_t t0 = esp_timer_get_time();
+            render_frame(frame_buf[frame_front ^ 1], &state, &segs, led_transition_at(&fade, now_ms),
+                         (uint32_t)(effect_us / 1000));
+            int64_t t1 = esp_timer_get_time();
+            compose_us_last = (uint32_t)(t1 - t0);
+            if (compose_us_last > compose_us_max) {
+                compose_us_max = compose_us_last;
             }
+            frame_show();
+            uint32_t show_us = (uint32_t)(esp_timer_get_time() - t1);
+            diag_write_begin();
+            render_diag.show_us = show_us;
+            if (show_us > render_diag.show_us_max) {
+                render_diag.show_us_max = show_us;
+            }
+            diag_write_end();
+        }
+        
+        // Fades and dithering need the full rate, effects what they declare
+        uint32_t fps = (fading || frame_dithered) ? state.render_fps : effect_fps(&state, &segs);
+        if (fps > state.render_fps) {
+            fps = state.render_fps;
+        }
+        frame_clock_set(fps);
+        if (fps > 0) {
+            effect_us += frame_clock_wait();
         } else {
-            vTaskDelay(pdMS_TO_TICKS(100));
+            // Idle until the control task changes the light or effect
+            uint32_t bits = 0;
+            while (!(bits & RENDER_WAKE_CHANGE)) {
+                xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+            }
         }
     }
 }
@@ -389,11 +1158,43 @@ void light_effect_task(void *pvParameters)
 // Sensor Reading
 int read_light_sensor(void)
 {
-    uint32_t adc_reading = 0;
-    for (int i = 0; i < 10; i++) {
-        adc_reading += adc1_get_raw(LIGHT_SENSOR_PIN);
+    static uint8_t frame[LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES];
+    uint16_t block[LIGHT_ADC_BLOCK];
+    uint32_t len = 0;
+    size_t n = 0;
+    
+    esp_err_t err = adc_continuous_start(light_adc);
+    if (err == ESP_OK) {
+        err = adc_continuous_read(light_adc, frame, sizeof(frame), &len, LIGHT_ADC_TIMEOUT_MS);
+        adc_continuous_stop(light_adc);
+        adc_continuous_flush_pool(light_adc);
     }
-    return (int)(adc_reading / 10);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sensor read failed: %s", esp_err_to_name(err));
+        return system_state.light_value;
+    }
+    
+    const adc_digi_output_data_t *out = (const adc_digi_output_data_t *)frame;
+    for (uint32_t i = 0; i < len / SOC_ADC_DIGI_RESULT_BYTES; i++) {
+        if (out[i].type1.channel == LIGHT_SENSOR_PIN) {
+            block[n++] = out[i].type1.data;
+        }
+    }
+    return (n > 0) ? adc_filter_run(&light_filter, block, n) : system_state.light_value;
+}
+
+// Store a filtered reading with its calibrated values
+static void set_light_reading(int raw)
+{
+    light_reading_t r;
+    light_cal_read(&light_cal, raw, &r);
+    state_write_begin();
+    system_state.light_value = r.raw;
+    system_state.light_mv = r.mv;
+    system_state.light_lux = r.lux;
+    system_state.light_percent = r.percent;
+    state_write_end_nopush();
+    status_push_light(r.raw);
 }
 
 bool read_pir_sensor(void)
@@ -401,6 +1202,131 @@ bool read_pir_sensor(void)
     return gpio_get_level(PIR_SENSOR_PIN);
 }
 
+// Post a control event from task context; never blocks the caller
+static bool post_light_event(ctrl_event_type_t type, int value, int transition_ms)
+{
+    ctrl_event_t evt = {
+        .type = type,
+        .at_us = esp_timer_get_time(),
+        .value = value,
+        .transition_ms = transition_ms,
+    };
+    if (xQueueSend(ctrl_evt_queue, &evt, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Control queue full, event %d dropped", type);
+        return false;
+    }
+    return true;
+}
+
+static bool post_ctrl_event(ctrl_event_type_t type, int value)
+{
+    return post_light_event(type, value, -1);
+}
+
+#if PIR_USE_INTERRUPT
+// PIR Edge Interrupt: hand the edge to the control task, which re-reads
+// the level itself so a bounced edge can't leave a stale state behind
+static void IRAM_ATTR pir_isr_handler(void *arg)
+{
+    ctrl_event_t evt = { .type = CTRL_EVT_PIR_EDGE, .at_us = esp_timer_get_time() };
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(ctrl_evt_queue, &evt, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void pir_interrupt_init(void)
+{
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(PIR_SENSOR_PIN, pir_isr_handler, NULL));
+}
+#endif
+
+// Calibration scheme callback for light_cal_build(); nominal 0-3.1V
+// scale without one
+static int light_cali_mv(int raw, void *ctx)
+{
+    int mv = raw * 3100 / 4095;
+    if (ctx != NULL) {
+        adc_cali_raw_to_voltage((adc_cali_handle_t)ctx, raw, &mv);
+    }
+    return mv;
+}
+
+// Light Sensor ADC: one-channel continuous-mode driver, started per burst
+static void light_adc_init(void)
+{
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES * 2,
+        .conv_frame_size = LIGHT_ADC_BLOCK * SOC_ADC_DIGI_RESULT_BYTES,
+    };
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_cfg, &light_adc));
+    
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = LIGHT_SENSOR_PIN,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t adc_config = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = LIGHT_ADC_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    ESP_ERROR_CHECK(adc_continuous_config(light_adc, &adc_config));
+    
+    // Calibration: the table is all that's kept, the scheme is freed again
+    adc_cali_handle_t cali = NULL;
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_12,
+        .default_vref = ADC_DEFAULT_VREF,
+    };
+    esp_err_t err = adc_cali_create_scheme_line_fitting(&cali_config, &cali);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "ADC calibration unavailable (%s), using nominal scale", esp_err_to_name(err));
+    }
+    light_cal_build(&light_cal, &light_cal_cfg, light_cali_mv, cali);
+    if (cali != NULL) {
+        adc_cali_delete_scheme_line_fitting(cali);
+    }
+    ESP_LOGI(TAG, "Light sensor: %d-sample bursts at %d Hz, %s filter",
+             LIGHT_ADC_BLOCK, LIGHT_ADC_SAMPLE_HZ, light_filter.name);
+}
+
+// Sensor Sampler Task: filters one ADC burst per period below the control
+// task's priority, forwards light threshold crossings, and PIR changes the
+// interrupt did not report (polling build, missed edges)
+void sensor_sample_task(void *pvParameters)
+{
+    bool was_dark = auto_light_classify(&auto_light_cfg, false, system_state.light_value);
+    TickType_t last_wake = xTaskGetTickCount();
+    TickType_t last_record = last_wake;
+    
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSOR_SAMPLE_PERIOD_MS));
+        
+        int value = read_light_sensor();
+        set_light_reading(value);
+        if (last_wake - last_record >= pdMS_TO_TICKS(TELEMETRY_SAMPLE_MS)) {
+            telemetry_record(TELEMETRY_SAMPLE);
+            last_record = last_wake;
+        }
+        bool dark = auto_light_classify(&auto_light_cfg, was_dark, value);
+        if (dark != was_dark && post_ctrl_event(CTRL_EVT_LIGHT_CROSS, value)) {
+            was_dark = dark;
+        }
+        
+        if (read_pir_sensor() != system_state.motion_detected) {
+            post_ctrl_event(CTRL_EVT_PIR_EDGE, 0);
+        }
+    }
+}
+
 // HTTP Server Handler Functions
 extern const char html_page_start[] asm("_binary_index_html_start");
 extern const char html_page_end[] asm("_binary_index_html_end");
@@ -412,6 +1338,46 @@ static esp_err_t root_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Status payload is built on the stack, no cJSON tree (see json_writer.h)
+#define STATUS_JSON_MAX     320
+
+// Status fields, or with prev set only those that differ from it (a delta)
+static void status_add_fields(json_writer_t *w, const system_state_t *s, const system_state_t *prev)
+{
+    if (prev == NULL || s->is_auto_mode != prev->is_auto_mode) {
+        json_add_bool(w, "auto_mode", s->is_auto_mode);
+    }
+    if (prev == NULL || s->is_light_on != prev->is_light_on) {
+        json_add_bool(w, "light_on", s->is_light_on);
+    }
+    if (prev == NULL || s->light_value != prev->light_value) {
+        json_add_int(w, "light_value", s->light_value);
+        json_add_int(w, "light_mv", s->light_mv);
+        json_add_int(w, "light_lux", s->light_lux);
+        json_add_int(w, "light_percent", s->light_percent);
+    }
+    if (prev == NULL || s->motion_detected != prev->motion_detected) {
+        json_add_bool(w, "motion", s->motion_detected);
+    }
+    if (prev == NULL || s->red != prev->red || s->green != prev->green || s->blue != prev->blue) {
+        json_add_int(w, "red", s->red);
+        json_add_int(w, "green", s->green);
+        json_add_int(w, "blue", s->blue);
+    }
+    if (prev == NULL || s->brightness != prev->brightness) {
+        json_add_int(w, "brightness", s->brightness);
+    }
+    if (prev == NULL || s->effect != prev->effect) {
+        json_add_int(w, "effect", s->effect);
+    }
+    if (prev == NULL || s->strip_length != prev->strip_length) {
+        json_add_int(w, "strip_length", s->strip_length);
+    }
+    if (prev == NULL || s->segment_count != prev->segment_count) {
+        json_add_int(w, "segments", s->segment_count);
+    }
+}
+
 static esp_err_t status_get_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, "Received status query request");
@@ -421,24 +1387,213 @@ static esp_err_t status_get_handler(httpd_req_t *req)
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
     
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddBoolToObject(root, "auto_mode", system_state.is_auto_mode);
-    cJSON_AddBoolToObject(root, "light_on", system_state.is_light_on);
-    cJSON_AddNumberToObject(root, "light_value", system_state.light_value);
-    cJSON_AddBoolToObject(root, "motion", system_state.motion_detected);
-    cJSON_AddNumberToObject(root, "red", system_state.red);
-    cJSON_AddNumberToObject(root, "green", system_state.green);
-    cJSON_AddNumberToObject(root, "blue", system_state.blue);
-    cJSON_AddNumberToObject(root, "brightness", system_state.brightness);
-    cJSON_AddNumberToObject(root, "effect", system_state.effect);
-    
-    char *json_str = cJSON_Print(root);
+    system_state_t state;
+    state_snapshot(&state);
+    
+    char buf[STATUS_JSON_MAX];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w, NULL);
+    status_add_fields(&w, &state, NULL);
+    // Changes every animated frame, so it is not pushed over /ws
+    json_add_int(&w, "power_ma", (int32_t)power_ma);
+    json_add_int(&w, "power_budget_ma", LED_POWER_BUDGET_MA);
+    json_obj_end(&w);
+    
+    if (!json_writer_ok(&w)) {
+        ESP_LOGE(TAG, "Status payload exceeds %d bytes", STATUS_JSON_MAX);
+        return httpd_resp_send_500(req);
+    }
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, json_str);
+    return httpd_resp_send(req, buf, w.len);
+}
+
+// GET /segments: every segment, and how long the last and the slowest
+// frame took to draw against the frame period
+#define SEGMENTS_JSON_MAX   (96 + LED_SEGMENT_MAX * 144)
+
+static esp_err_t segments_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     
-    free(json_str);
-    cJSON_Delete(root);
-    return ESP_OK;
+    system_state_t state;
+    state_snapshot(&state);
+    static led_segments_t segs;             // httpd serves one request at a time
+    segments_snapshot(&segs);
+    
+    static char buf[SEGMENTS_JSON_MAX];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w, NULL);
+    json_add_int(&w, "frame_us", 1000000 / state.render_fps);
+    json_add_int(&w, "compose_us", (int32_t)compose_us_last);
+    json_add_int(&w, "compose_us_max", (int32_t)compose_us_max);
+    json_add_int(&w, "outputs", out_count);
+    json_arr_begin(&w, "segments");
+    for (int i = 0; i < segs.count; i++) {
+        const led_segment_t *seg = &segs.seg[i];
+        json_obj_begin(&w, NULL);
+        json_add_str(&w, "name", seg->name);
+        json_add_int(&w, "start", seg->start);
+        json_add_int(&w, "length", seg->len);
+        json_add_int(&w, "effect", seg->effect);
+        json_add_int(&w, "r", seg->color.r);
+        json_add_int(&w, "g", seg->color.g);
+        json_add_int(&w, "b", seg->color.b);
+        json_add_int(&w, "brightness", seg->brightness);
+        json_add_int(&w, "speed", seg->speed);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    
+    if (!json_writer_ok(&w)) {
+        ESP_LOGE(TAG, "Segments payload exceeds %d bytes", SEGMENTS_JSON_MAX);
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, w.len);
+}
+
+// GET /effects: the effect registry, so clients can offer what this
+// firmware draws
+#define EFFECTS_JSON_MAX    (32 + LED_EFFECT_COUNT * 144)
+
+static esp_err_t effects_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    char buf[EFFECTS_JSON_MAX];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w, NULL);
+    json_arr_begin(&w, "effects");
+    for (int i = 0; i < LED_EFFECT_COUNT; i++) {
+        const led_effect_desc_t *fx = led_effect_get(i);
+        if (fx == NULL) {
+            continue;
+        }
+        json_obj_begin(&w, NULL);
+        json_add_int(&w, "id", i);
+        json_add_str(&w, "name", fx->name);
+        json_add_int(&w, "fps", fx->fps);
+        json_add_int(&w, "speed", fx->default_speed);
+        json_add_bool(&w, "color", (fx->uses & LED_FX_USES_COLOR) != 0);
+        json_add_bool(&w, "speed_adjusts", (fx->uses & LED_FX_USES_SPEED) != 0);
+        json_add_bool(&w, "fps_follows_speed", (fx->uses & LED_FX_HUE_STEPS) != 0);
+        json_obj_end(&w);
+    }
+    json_arr_end(&w);
+    json_obj_end(&w);
+    
+    if (!json_writer_ok(&w)) {
+        ESP_LOGE(TAG, "Effects payload exceeds %d bytes", EFFECTS_JSON_MAX);
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, w.len);
+}
+
+// GET /render: the frame clock, and how well frames keep to it
+#define RENDER_JSON_MAX     256
+
+static esp_err_t render_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    system_state_t state;
+    state_snapshot(&state);
+    render_diag_t d;
+    diag_snapshot(&d);
+    
+    char buf[RENDER_JSON_MAX];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w, NULL);
+    json_add_int(&w, "target_fps", state.render_fps);
+    json_add_int(&w, "fps", (int32_t)d.fps);
+    json_add_int(&w, "frames", (int32_t)d.frames);
+    json_add_int(&w, "missed", (int32_t)d.missed);
+    json_add_int(&w, "jitter_us", (int32_t)d.jitter_us);
+    json_add_int(&w, "jitter_us_avg", d.frames ? (int32_t)(d.jitter_us_sum / d.frames) : 0);
+    json_add_int(&w, "jitter_us_max", (int32_t)d.jitter_us_max);
+    json_add_int(&w, "compose_us_max", (int32_t)compose_us_max);
+    json_add_int(&w, "show_us", (int32_t)d.show_us);
+    json_add_int(&w, "show_us_max", (int32_t)d.show_us_max);
+    json_obj_end(&w);
+    
+    if (!json_writer_ok(&w)) {
+        ESP_LOGE(TAG, "Render payload exceeds %d bytes", RENDER_JSON_MAX);
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, buf, w.len);
+}
+
+static int json_int_or(cJSON *obj, const char *key, int dflt)
+{
+    cJSON *item = cJSON_GetObjectItem(obj, key);
+    return cJSON_IsNumber(item) ? item->valueint : dflt;
+}
+
+// set_segment: name, start, length, and optionally effect, r/g/b,
+// brightness and speed; delete_segment: name. A segment may reach past the
+// current strip (led_compose clips it), not past the longest one allowed.
+// A bad command sets *error and posts nothing.
+static bool post_segment_cmd(cJSON *root, bool set, const char **error)
+{
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    if (!cJSON_IsString(name) || name->valuestring[0] == '\0') {
+        *error = "segment needs a name";
+        return true;
+    }
+    led_segment_t seg = { 0 };
+    strncpy(seg.name, name->valuestring, LED_SEGMENT_NAME_MAX - 1);
+    if (set) {
+        // "effect" is optional (solid), but if given must be a known one
+        cJSON *effect = cJSON_GetObjectItem(root, "effect");
+        const led_effect_desc_t *fx = led_effect_get(EFFECT_NONE);
+        if (effect != NULL) {
+            fx = cJSON_IsNumber(effect) ? led_effect_get(effect->valueint) : NULL;
+        }
+        int start = json_int_or(root, "start", -1);
+        int len = json_int_or(root, "length", 0);
+        if (start < 0) {
+            *error = "segment needs a start of 0 or more";
+        } else if (len <= 0) {
+            *error = "segment needs a length of 1 or more";
+        } else if (start + len > LED_STRIP_LENGTH_LIMIT) {
+            *error = "segment ends past the longest strip";
+        } else if (fx == NULL) {
+            *error = "unknown effect";
+        }
+        if (*error != NULL) {
+            return true;
+        }
+        seg.start = (uint16_t)start;
+        seg.len = (uint16_t)len;
+        seg.effect = (uint8_t)(fx - led_effect_table);
+        seg.color.r = (uint8_t)json_int_or(root, "r", 255);
+        seg.color.g = (uint8_t)json_int_or(root, "g", 255);
+        seg.color.b = (uint8_t)json_int_or(root, "b", 255);
+        int brightness = json_int_or(root, "brightness", 100);
+        seg.brightness = (uint8_t)((brightness < 0) ? 0 : (brightness > 100) ? 100 : brightness);
+        int speed = json_int_or(root, "speed", fx->default_speed);
+        seg.speed = (uint8_t)((speed < 0) ? 0 : (speed > 99) ? 99 : speed);
+    }
+    
+    ctrl_event_t evt = {
+        .type = set ? CTRL_EVT_CMD_SET_SEGMENT : CTRL_EVT_CMD_DELETE_SEGMENT,
+        .at_us = esp_timer_get_time(),
+        .value = segment_cmd_next,
+    };
+    segment_cmd[segment_cmd_next] = seg;
+    segment_cmd_next = (uint8_t)((segment_cmd_next + 1) % SEGMENT_CMD_SLOTS);
+    if (xQueueSend(ctrl_evt_queue, &evt, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Control queue full, segment command dropped");
+        return false;
+    }
+    return true;
 }
 
 static esp_err_t control_post_handler(httpd_req_t *req)
@@ -450,7 +1605,7 @@ static esp_err_t control_post_handler(httpd_req_t *req)
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
     
-    char buf[200];
+    char buf[256];
     int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
     if (ret <= 0) {
         ESP_LOGE(TAG, "Failed to receive data");
@@ -468,46 +1623,195 @@ static esp_err_t control_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
     
+    // Commands are applied by the control task, in arrival order; unknown
+    // effects and bad segments, frame rates or strip lengths are refused here
+    bool posted = true;
+    const char *error = NULL;
     cJSON *action = cJSON_GetObjectItem(root, "action");
     if (action && cJSON_IsString(action)) {
         const char *cmd = action->valuestring;
         
+        // Light commands may carry "transition_ms"
+        int fade_ms = json_int_or(root, "transition_ms", -1);
         if (strcmp(cmd, "on") == 0) {
-            system_state.effect = EFFECT_NONE;
-            turn_on_light();
+            posted = post_light_event(CTRL_EVT_CMD_ON, 0, fade_ms);
         } else if (strcmp(cmd, "off") == 0) {
-            turn_off_light();
+            posted = post_light_event(CTRL_EVT_CMD_OFF, 0, fade_ms);
         } else if (strcmp(cmd, "toggle_mode") == 0) {
-            system_state.is_auto_mode = !system_state.is_auto_mode;
+            posted = post_ctrl_event(CTRL_EVT_CMD_TOGGLE_MODE, 0);
         } else if (strcmp(cmd, "set_color") == 0) {
             cJSON *r = cJSON_GetObjectItem(root, "r");
             cJSON *g = cJSON_GetObjectItem(root, "g");
             cJSON *b = cJSON_GetObjectItem(root, "b");
             if (r && g && b) {
-                system_state.effect = EFFECT_NONE;
-                set_rgb_color(r->valueint, g->valueint, b->valueint);
+                int rgb = ((r->valueint & 0xFF) << 16) | ((g->valueint & 0xFF) << 8) | (b->valueint & 0xFF);
+                posted = post_light_event(CTRL_EVT_CMD_SET_COLOR, rgb, fade_ms);
             }
         } else if (strcmp(cmd, "set_brightness") == 0) {
             cJSON *brightness = cJSON_GetObjectItem(root, "brightness");
             if (brightness) {
-                set_brightness(brightness->valueint);
+                posted = post_light_event(CTRL_EVT_CMD_SET_BRIGHTNESS, brightness->valueint, fade_ms);
             }
         } else if (strcmp(cmd, "set_effect") == 0) {
             cJSON *effect = cJSON_GetObjectItem(root, "effect");
             if (effect) {
-                system_state.effect = effect->valueint;
-                if (system_state.effect != EFFECT_NONE && !system_state.is_light_on) {
-                    turn_on_light();
+                if (cJSON_IsNumber(effect) && led_effect_get(effect->valueint) != NULL) {
+                    posted = post_ctrl_event(CTRL_EVT_CMD_SET_EFFECT, effect->valueint);
+                } else {
+                    error = "unknown effect";
                 }
             }
+        } else if (strcmp(cmd, "set_segment") == 0 || strcmp(cmd, "delete_segment") == 0) {
+            posted = post_segment_cmd(root, strcmp(cmd, "set_segment") == 0, &error);
+        } else if (strcmp(cmd, "set_strip_length") == 0) {
+            cJSON *length = cJSON_GetObjectItem(root, "length");
+            if (length && (!cJSON_IsNumber(length) || length->valueint < 1)) {
+                error = "strip length must be a number of 1 or more";
+            } else if (length && length->valueint > LED_STRIP_LENGTH_LIMIT) {
+                ESP_LOGW(TAG, "Strip length %d refused: longest is %d (%d mA budget)",
+                         length->valueint, LED_STRIP_LENGTH_LIMIT, LED_POWER_BUDGET_MA);
+                error = "strip too long for the power budget";
+            } else if (length) {
+                posted = post_ctrl_event(CTRL_EVT_CMD_SET_LENGTH, length->valueint);
+            }
+        } else if (strcmp(cmd, "set_fps") == 0) {
+            cJSON *fps = cJSON_GetObjectItem(root, "fps");
+            if (fps && (!cJSON_IsNumber(fps) || fps->valueint < 1 || fps->valueint > RENDER_FPS_MAX)) {
+                error = "fps out of range";
+            } else if (fps) {
+                posted = post_ctrl_event(CTRL_EVT_CMD_SET_FPS, fps->valueint);
+            }
         }
     }
     
     cJSON_Delete(root);
+    if (error != NULL) {
+        char body[96];
+        snprintf(body, sizeof(body), "{\"status\":\"error\",\"error\":\"%s\"}", error);
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, body);
+        return ESP_OK;
+    }
+    if (!posted) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
     httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
     return ESP_OK;
 }
 
+// WebSocket /ws: a client gets the full status once connected, then only
+// the fields that changed. Changes within STATUS_PUSH_COALESCE_MS go out
+// as one frame; the light reading only counts as changed once it has moved
+// by STATUS_PUSH_LIGHT_STEP, so sensor noise does not stream to clients.
+// Needs CONFIG_HTTPD_WS_SUPPORT.
+#ifndef STATUS_PUSH_COALESCE_MS
+#define STATUS_PUSH_COALESCE_MS 50
+#endif
+#define STATUS_PUSH_LIGHT_STEP  32
+#define STATUS_WS_RX_MAX        64
+
+// Clients (see ws_clients.h) and the last pushed state are only touched
+// in the server task
+static ws_clients_t ws_clients = { .tag = "SmartLight" };
+static system_state_t push_sent;
+static esp_timer_handle_t status_push_timer = NULL;
+
+// Runs in the server task (httpd_queue_work), which owns the sockets
+static void status_push_work(void *arg)
+{
+    system_state_t state;
+    state_snapshot(&state);
+    
+    char full[STATUS_JSON_MAX];
+    json_writer_t fw;
+    json_writer_init(&fw, full, sizeof(full));
+    json_obj_begin(&fw, NULL);
+    status_add_fields(&fw, &state, NULL);
+    json_obj_end(&fw);
+    
+    // Below the step, clients keep the reading they already have
+    if (abs(state.light_value - push_sent.light_value) < STATUS_PUSH_LIGHT_STEP) {
+        state.light_value = push_sent.light_value;
+        state.light_mv = push_sent.light_mv;
+        state.light_lux = push_sent.light_lux;
+        state.light_percent = push_sent.light_percent;
+    }
+    char delta[STATUS_JSON_MAX];
+    json_writer_t dw;
+    json_writer_init(&dw, delta, sizeof(delta));
+    json_obj_begin(&dw, NULL);
+    status_add_fields(&dw, &state, &push_sent);
+    json_obj_end(&dw);
+    bool changed = dw.len > 2;     // More than "{}"
+    
+    if (!json_writer_ok(&fw) || !json_writer_ok(&dw)) {
+        ESP_LOGE(TAG, "Status payload exceeds %d bytes", STATUS_JSON_MAX);
+        return;
+    }
+    ws_clients_push(&ws_clients, server, full, fw.len, delta, dw.len, changed);
+    push_sent = state;
+}
+
+static void status_push_timer_cb(void *arg)
+{
+    if (httpd_queue_work(server, status_push_work, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Status push not queued");
+    }
+}
+
+// Called after every system_state update, from any task
+static void status_push_kick(void)
+{
+    // Already armed: this change goes out with the pending push
+    if (ws_clients.count > 0 && status_push_timer != NULL &&
+        !esp_timer_is_active(status_push_timer)) {
+        esp_timer_start_once(status_push_timer, STATUS_PUSH_COALESCE_MS * 1000);
+    }
+}
+
+// Sensor noise moves the reading a little every sample: only wake the push
+// once it is STATUS_PUSH_LIGHT_STEP away from what clients were sent. The
+// unlocked read of push_sent is one aligned word; a stale value only moves
+// the push by a sample.
+static void status_push_light(int raw)
+{
+    if (abs(raw - push_sent.light_value) >= STATUS_PUSH_LIGHT_STEP) {
+        status_push_kick();
+    }
+}
+
+static void status_push_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = status_push_timer_cb,
+        .name = "status_push"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &status_push_timer));
+}
+
+// WebSocket Handler - Status Push (/ws)
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake done: the next push sends this client the full status
+        int fd = httpd_req_to_sockfd(req);
+        if (!ws_clients_add(&ws_clients, fd)) {
+            ESP_LOGW(TAG, "Status push: no room for client %d", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Status push: client %d connected", fd);
+        status_push_kick();
+        return ESP_OK;
+    }
+    
+    // Clients send nothing we act on; read the frame and drop it
+    uint8_t payload[STATUS_WS_RX_MAX];
+    httpd_ws_frame_t frame = { .payload = payload };
+    return httpd_ws_recv_frame(req, &frame, sizeof(payload));
+}
+
 // OPTIONS Preflight Request Handler (CORS)
 static esp_err_t options_handler(httpd_req_t *req)
 {
@@ -530,78 +1834,212 @@ httpd_handle_t start_webserver(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
+    config.max_uri_handlers = 12;
     
     if (httpd_start(&server, &config) == ESP_OK) {
         httpd_uri_t root_uri = {.uri = "/", .method = HTTP_GET, .handler = root_get_handler};
         httpd_uri_t status_uri = {.uri = "/status", .method = HTTP_GET, .handler = status_get_handler};
         httpd_uri_t control_uri = {.uri = "/control", .method = HTTP_POST, .handler = control_post_handler};
+        httpd_uri_t segments_uri = {.uri = "/segments", .method = HTTP_GET, .handler = segments_get_handler};
+        httpd_uri_t effects_uri = {.uri = "/effects", .method = HTTP_GET, .handler = effects_get_handler};
+        httpd_uri_t render_uri = {.uri = "/render", .method = HTTP_GET, .handler = render_get_handler};
         
         // Add OPTIONS handlers for CORS preflight
         httpd_uri_t options_status_uri = {.uri = "/status", .method = HTTP_OPTIONS, .handler = options_handler};
         httpd_uri_t options_control_uri = {.uri = "/control", .method = HTTP_OPTIONS, .handler = options_handler};
         
+        // Status push (see ws_handler)
+        httpd_uri_t ws_uri = {.uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true};
+        
         httpd_register_uri_handler(server, &root_uri);
         httpd_register_uri_handler(server, &status_uri);
         httpd_register_uri_handler(server, &options_status_uri);
         httpd_register_uri_handler(server, &control_uri);
         httpd_register_uri_handler(server, &options_control_uri);
+        httpd_register_uri_handler(server, &segments_uri);
+        httpd_register_uri_handler(server, &effects_uri);
+        httpd_register_uri_handler(server, &render_uri);
+        httpd_register_uri_handler(server, &ws_uri);
+        status_push_init();
         
         ESP_LOGI(TAG, "HTTP Server started successfully on port: 80");
     }
     return server;
 }
 
-// Sensor Monitor Task
-void sensor_monitor_task(void *pvParameters)
+// Auto Mode Logic
+static void evaluate_auto_mode(void)
+{
+    if (!system_state.is_auto_mode) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t recheck_us;
+    bool should_on = auto_light_decide(&auto_light, now, &recheck_us);
+    
+    if (should_on && !system_state.is_light_on) {
+        ESP_LOGI(TAG, "Auto Mode Triggered ON - Light=%d, Threshold=%d/%d, Motion=%s", 
+                 system_state.light_value, auto_light_cfg.dark_threshold,
+                 auto_light_cfg.bright_threshold, system_state.motion_detected ? "YES" : "held");
+        set_solid();
+        turn_on_light();
+    } else if (!should_on && system_state.is_light_on) {
+        ESP_LOGI(TAG, "Auto Mode Triggered OFF");
+        turn_off_light();
+    }
+    
+    // Come back when the hold-off or dwell time runs out
+    esp_timer_stop(auto_light_timer);
+    if (recheck_us != AUTO_LIGHT_NO_RECHECK) {
+        esp_timer_start_once(auto_light_timer, recheck_us - now);
+    }
+}
+static void auto_light_timer_cb(void *arg)
+{
+    post_ctrl_event(CTRL_EVT_AUTO_TIMER, 0);
+}
+
+// Push Timer: data push runs on the uploader task, not in the timer
+static void push_timer_cb(void *arg)
+{
+    upload_req_t req = { .at_us = esp_timer_get_time() };
+    if (xQueueSend(upload_queue, &req, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Uploader busy, push skipped");
+    }
+}
+
+// Uploader Task: owns the HTTP client and the spool
+static void upload_task(void *pvParameters)
 {
-    ESP_LOGI(TAG, "Sensor monitor task started");
-    TickType_t last_push_time = 0;
-    uint32_t log_counter = 0;
-    bool last_motion = false;
+    telemetry_push_init(&uploader, &uploader_config);
     
+    upload_req_t req;
     while (1) {
-        system_state.light_value = read_light_sensor();
-        system_state.motion_detected = read_pir_sensor();
+        xQueueReceive(upload_queue, &req, portMAX_DELAY);
+        ESP_LOGI(TAG, "Starting data push to server (due %lld ms ago)...",
+                 (long long)((esp_timer_get_time() - req.at_us) / 1000));
+        push_sensor_data();
         
-        // Log immediately when PIR status changes
-        if (system_state.motion_detected != last_motion) {
-            ESP_LOGI(TAG, "*** PIR Status Changed: %s ***", 
-                     system_state.motion_detected ? "Motion Detected" : "Motion Cleared");
-            last_motion = system_state.motion_detected;
+        uint32_t worst = ctrl_worst_pickup_us;
+        ctrl_worst_pickup_us = 0;
+        ESP_LOGI(TAG, "Control loop: worst event pickup %lu.%03lu ms since last push",
+                 (unsigned long)(worst / 1000), (unsigned long)(worst % 1000));
+    }
+}
+
+// Control Task: blocks until an event arrives, applies it, re-evaluates
+void control_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Control task started");
+    
+    // Start from the current inputs instead of waiting for the first event
+    bool initial_motion = read_pir_sensor();
+    state_write_begin();
+    system_state.motion_detected = initial_motion;
+    state_write_end();
+    auto_light_init(&auto_light, &auto_light_cfg, system_state.light_value,
+                    system_state.motion_detected, system_state.is_light_on, esp_timer_get_time());
+    
+    const esp_timer_create_args_t auto_timer_args = {
+        .callback = auto_light_timer_cb,
+        .name = "auto_light",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&auto_timer_args, &auto_light_timer));
+    evaluate_auto_mode();
+    
+    ctrl_event_t evt;
+    while (1) {
+        xQueueReceive(ctrl_evt_queue, &evt, portMAX_DELAY);
+        int64_t pickup_us = esp_timer_get_time() - evt.at_us;
+        if (pickup_us > (int64_t)ctrl_worst_pickup_us) {
+            ctrl_worst_pickup_us = (uint32_t)pickup_us;
         }
+        ESP_LOGD(TAG, "Event %d picked up after %lld us", evt.type, (long long)pickup_us);
         
-        // Log sensor status every 2 seconds (4 loops * 500ms)
-        if (log_counter % 4 == 0) {
-            ESP_LOGI(TAG, "Sensor Status - Light=%d, Motion=%s, Lamp=%s(%d,%d,%d,%d%%), Mode=%s",
-                     system_state.light_value,
-                     system_state.motion_detected ? "YES" : "NO",
-                     system_state.is_light_on ? "ON" : "OFF",
-                     system_state.red, system_state.green, system_state.blue, 
-                     system_state.brightness,system_state.is_auto_mode ? "Auto" : "Manual");
+        // Only light commands fade, and only the changes they make
+        int fade_ms = evt.transition_ms;
+        bool light_cmd = (evt.type == CTRL_EVT_CMD_ON || evt.type == CTRL_EVT_CMD_OFF ||
+                          evt.type == CTRL_EVT_CMD_SET_COLOR || evt.type == CTRL_EVT_CMD_SET_BRIGHTNESS);
+        if (light_cmd && fade_ms < 0) {
+            bool on_off = (evt.type == CTRL_EVT_CMD_ON || evt.type == CTRL_EVT_CMD_OFF);
+            fade_ms = on_off ? 0 : LED_TRANSITION_MS;
         }
-        log_counter++;
+        set_light_fade(light_cmd ? fade_ms : 0);
         
-        if (system_state.is_auto_mode) {
-            bool should_on = (system_state.light_value > LIGHT_THRESHOLD) && system_state.motion_detected;
-            
-            if (should_on && !system_state.is_light_on) {
-                ESP_LOGI(TAG, "Auto Mode Triggered ON - Light=%d > Threshold=%d, Motion Detected", 
-                         system_state.light_value, LIGHT_THRESHOLD);
-                system_state.effect = EFFECT_NONE;
+        switch (evt.type) {
+            case CTRL_EVT_PIR_EDGE: {
+                bool motion = read_pir_sensor();
+                if (motion == system_state.motion_detected) {
+                    continue;  // Bounce or already handled
+                }
+                // The sampler keeps light_value fresh; no ADC work here
+                state_write_begin();
+                system_state.motion_detected = motion;
+                state_write_end();
+                telemetry_record(TELEMETRY_MOTION);
+                auto_light_set_light(&auto_light, system_state.light_value);
+                auto_light_set_motion(&auto_light, motion, esp_timer_get_time());
+                ESP_LOGI(TAG, "*** PIR Status Changed: %s ***", 
+                         motion ? "Motion Detected" : "Motion Cleared");
+                break;
+            }
+            case CTRL_EVT_LIGHT_CROSS:
+                // The sampler has already stored the reading
+                auto_light_set_light(&auto_light, evt.value);
+                break;
+            case CTRL_EVT_AUTO_TIMER:
+                break;
+            case CTRL_EVT_CMD_ON:
+                set_solid();
                 turn_on_light();
-            } else if (!should_on && system_state.is_light_on) {
-                ESP_LOGI(TAG, "Auto Mode Triggered OFF");
+                break;
+            case CTRL_EVT_CMD_OFF:
                 turn_off_light();
-            }
+                break;
+            case CTRL_EVT_CMD_TOGGLE_MODE:
+                state_write_begin();
+                system_state.is_auto_mode = !system_state.is_auto_mode;
+                state_write_end();
+                telemetry_record(TELEMETRY_MODE);
+                break;
+            case CTRL_EVT_CMD_SET_COLOR:
+                set_solid();
+                set_rgb_color((evt.value >> 16) & 0xFF, (evt.value >> 8) & 0xFF, evt.value & 0xFF);
+                break;
+            case CTRL_EVT_CMD_SET_BRIGHTNESS:
+                set_brightness(evt.value);
+                break;
+            case CTRL_EVT_CMD_SET_EFFECT:
+                set_effect(evt.value);
+                if (system_state.effect != EFFECT_NONE && !system_state.is_light_on) {
+                    turn_on_light();
+                }
+                break;
+            case CTRL_EVT_CMD_SET_LENGTH:
+                set_strip_length(evt.value);
+                break;
+            case CTRL_EVT_CMD_SET_FPS:
+                set_render_fps(evt.value);
+                break;
+            case CTRL_EVT_CMD_SET_SEGMENT:
+                set_segment(&segment_cmd[evt.value]);
+                break;
+            case CTRL_EVT_CMD_DELETE_SEGMENT:
+                delete_segment(segment_cmd[evt.value].name);
+                break;
         }
         
-        if ((xTaskGetTickCount() - last_push_time) > pdMS_TO_TICKS(PUSH_INTERVAL)) {
-            ESP_LOGI(TAG, "Starting data push to server...");
-            push_sensor_data();
-            last_push_time = xTaskGetTickCount();
-        }
+        system_state_t state;
+        state_snapshot(&state);
+        ESP_LOGI(TAG, "Sensor Status - Light=%d (%d mV, %d lx), Motion=%s, Lamp=%s(%d,%d,%d,%d%%), Mode=%s",
+                 state.light_value, state.light_mv, state.light_lux,
+                 state.motion_detected ? "YES" : "NO",
+                 state.is_light_on ? "ON" : "OFF",
+                 state.red, state.green, state.blue, 
+                 state.brightness, state.is_auto_mode ? "Auto" : "Manual");
         
-        vTaskDelay(pdMS_TO_TICKS(500));
+        evaluate_auto_mode();
+        xTaskNotify(render_task_handle, RENDER_WAKE_CHANGE, eSetBits);
     }
 }
 
@@ -613,44 +2051,41 @@ void app_main(void)
     ESP_LOGI(TAG, "Device ID: %s", DEVICE_ID);
     ESP_LOGI(TAG, "Push URL: %s", PUSH_URL);
     ESP_LOGI(TAG, "Push Interval: %d ms", PUSH_INTERVAL);
-    ESP_LOGI(TAG, "Light Threshold: %d", LIGHT_THRESHOLD);
+    ESP_LOGI(TAG, "Light Threshold: %d (hysteresis %d)", LIGHT_THRESHOLD, LIGHT_HYSTERESIS);
     ESP_LOGI(TAG, "========================================");
     
     ESP_ERROR_CHECK(nvs_flash_init());
     
+    // Control Event Queue (the PIR ISR, sampler and HTTP handlers post into it)
+    ctrl_evt_queue = xQueueCreate(CTRL_EVT_QUEUE_LEN, sizeof(ctrl_event_t));
+    
     // Configure PIR Sensor
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << PIR_SENSOR_PIN),
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
+        .intr_type = PIR_USE_INTERRUPT ? GPIO_INTR_ANYEDGE : GPIO_INTR_DISABLE
     };
     gpio_config(&io_conf);
+#if PIR_USE_INTERRUPT
+    pir_interrupt_init();
+#endif
     
-    // Configure ADC
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(LIGHT_SENSOR_PIN, ADC_ATTEN_DB_11);
-    adc_chars = calloc(1, sizeof(esp_adc_cal_characteristics_t));
-    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, adc_chars);
-    
-    // Initialize LED Strip
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = WS2812_PIN,
-        .max_leds = LED_STRIP_LENGTH,
-        .led_pixel_format = LED_PIXEL_FORMAT_GRB,
-        .led_model = LED_MODEL_WS2812,
-        .flags.invert_out = false,
-    };
+    // Configure ADC and take the first reading
+    light_adc_init();
+    set_light_reading(read_light_sensor());
     
-    led_strip_rmt_config_t rmt_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = LED_STRIP_RMT_RES_HZ,
-        .flags.with_dma = false,
-    };
-    
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
-    led_strip_clear(led_strip);
+    // Initialize LED Strip at the saved length and frame rate
+    system_state.strip_length = led_setting_load(LED_NVS_KEY_LENGTH, LED_STRIP_LENGTH, LED_STRIP_LENGTH_LIMIT);
+    system_state.render_fps = (uint8_t)led_setting_load(LED_NVS_KEY_FPS, RENDER_FPS, RENDER_FPS_MAX);
+    if (strip_open(system_state.strip_length) != ESP_OK) {
+        ESP_LOGE(TAG, "No room for the saved %u pixels, back to %d",
+                 system_state.strip_length, LED_STRIP_LENGTH);
+        system_state.strip_length = LED_STRIP_LENGTH;
+        ESP_ERROR_CHECK(strip_open(LED_STRIP_LENGTH));
+        led_setting_save(LED_NVS_KEY_LENGTH, LED_STRIP_LENGTH);
+    }
     
     // Initialize WiFi
     wifi_init_sta();
@@ -659,12 +2094,39 @@ void app_main(void)
     ESP_LOGI(TAG, "Starting HTTP Server...");
     start_webserver();
     
-    // Create Tasks
-    ESP_LOGI(TAG, "Creating Sensor Monitor Task...");
-    xTaskCreate(sensor_monitor_task, "sensor_monitor", 4096, NULL, 5, NULL);
+    // Create Tasks (the control task notifies the render task, so it goes first)
+    ESP_LOGI(TAG, "Creating Render Task...");
+    xTaskCreate(render_task, "render", 4096, NULL, 5, &render_task_handle);
     
-    ESP_LOGI(TAG, "Creating Light Effect Task...");
-    xTaskCreate(light_effect_task, "light_effect", 4096, NULL, 5, NULL);
+    ESP_LOGI(TAG, "Creating Control Task...");
+    xTaskCreate(control_task, "control_task", 4096, NULL, 5, NULL);
+    
+    // Sensor Sampler feeds the control task
+    xTaskCreate(sensor_sample_task, "sensor_sample", 3072, NULL, 3, NULL);
+    
+    // Uploader, fed by the push timer
+    upload_queue = xQueueCreate(UPLOAD_QUEUE_LEN, sizeof(upload_req_t));
+    xTaskCreate(upload_task, "upload", 8192, NULL, UPLOAD_TASK_PRIORITY, NULL);
+    const esp_timer_create_args_t push_timer_args = {
+        .callback = push_timer_cb,
+        .name = "data_push",
+    };
+    esp_timer_handle_t push_timer;
+    ESP_ERROR_CHECK(esp_timer_create(&push_timer_args, &push_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(push_timer, (uint64_t)PUSH_INTERVAL * 1000));
+    
+#if CTRL_LIGHT_SLEEP
+    // Idle between events in light sleep
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = 240,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true,
+    };
+    esp_err_t pm_err = esp_pm_configure(&pm_config);
+    if (pm_err != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep not enabled: %s", esp_err_to_name(pm_err));
+    }
+#endif
     
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, "System initialization complete, starting operation");
@@ -0,0 +1,389 @@
+/*
+ * Telemetry Push - Batched Upload over a Kept-Alive HTTP Client
+ *
+ * Shared by the firmware variants that push telemetry. One uploader task
+ * owns a telemetry_push_t: it drains the RAM ring (telemetry_ring.h) in
+ * batches of up to TELEMETRY_BATCH_MAX records, encodes them as JSON or
+ * CBOR (telemetry_cbor.h) and POSTs them on one HTTP client kept for the
+ * life of the firmware, so pushes reuse the connection (and, over TLS,
+ * resume the session) instead of opening one each time. Batches the
+ * server did not take go to the flash spool (telemetry_spool.h) and are
+ * sent, oldest first, before anything newer.
+ *
+ * The firmware keeps what differs between the variants: the ring and its
+ * lock (filled by its own tasks), the URL and transport, the JSON record
+ * layout and the colour CBOR records carry.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_http_client.h"
+#include "push_stats.h"
+#include "telemetry_ring.h"
+#include "telemetry_spool.h"
+#include "telemetry_cbor.h"
+
+#ifndef TELEMETRY_BATCH_MAX
+#define TELEMETRY_BATCH_MAX         32
+#endif
+
+// Batch body: sized for the worst-case JSON batch, which CBOR never exceeds
+#define TELEMETRY_RECORD_JSON_MAX   192
+#define TELEMETRY_BATCH_JSON_MAX    (192 + TELEMETRY_BATCH_MAX * TELEMETRY_RECORD_JSON_MAX)
+
+typedef struct {
+    const char *tag;                // Log tag of the firmware
+    const char *device_id;
+    esp_http_client_config_t http;  // URL and transport; the rest is set here
+    bool cbor;                      // Start with CBOR (see telemetry_cbor.h)
+    telemetry_ring_t *ring;
+    portMUX_TYPE *ring_mux;
+    const char *spool_label;        // Data partition; RAM only without one
+    int drain_batches;              // Spooled POSTs per push at most
+    int drain_gap_ms;               // between them
+    // JSON batch into buf, 0 if it does not fit
+    size_t (*batch_json)(char *buf, size_t cap, const telemetry_record_t *rec, uint32_t n);
+    // Colour CBOR batches carry (red, green, blue, brightness); NULL for none
+    void (*batch_color)(uint8_t color[4]);
+} telemetry_push_config_t;
+
+typedef struct {
+    const telemetry_push_config_t *cfg;
+    esp_http_client_handle_t client;
+    bool conn_open;                 // Tracked from the client's events
+    int64_t last_us;                // End of the last push
+    push_idle_t idle;               // Learned server idle timeout
+    push_stats_t stats;
+    bool cbor;                      // Cleared if the server rejects CBOR
+    telemetry_spool_t spool;
+    bool spool_ready;
+    uint32_t refused;               // Records in batches the server refused as malformed
+    telemetry_record_t batch[TELEMETRY_BATCH_MAX];
+    char body[TELEMETRY_BATCH_JSON_MAX];
+} telemetry_push_t;
+
+// ==================== Client ====================
+
+static inline esp_err_t telemetry_push_event(esp_http_client_event_t *evt)
+{
+    telemetry_push_t *tp = evt->user_data;
+    switch (evt->event_id) {
+        case HTTP_EVENT_ERROR:
+            ESP_LOGI(tp->cfg->tag, "HTTP Push Error");
+            break;
+        case HTTP_EVENT_ON_CONNECTED:
+            ESP_LOGI(tp->cfg->tag, "HTTP Connected");
+            tp->conn_open = true;
+            break;
+        case HTTP_EVENT_ON_DATA:
+            if (!esp_http_client_is_chunked_response(evt->client)) {
+                ESP_LOGD(tp->cfg->tag, "Server: %.*s", evt->data_len, (char *)evt->data);
+            }
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            ESP_LOGI(tp->cfg->tag, "HTTP Disconnected");
+            tp->conn_open = false;
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+static inline esp_http_client_handle_t telemetry_push_client(telemetry_push_t *tp)
+{
+    if (tp->client == NULL) {
+        ESP_LOGI(tp->cfg->tag, "Configuring HTTP Client for data push");
+        esp_http_client_config_t config = tp->cfg->http;
+        config.event_handler = telemetry_push_event;
+        config.user_data = tp;
+        config.method = HTTP_METHOD_POST;
+        config.timeout_ms = 5000;
+        config.keep_alive_enable = true;    // TCP keep-alive: notice a dead peer
+        tp->client = esp_http_client_init(&config);
+        if (tp->client == NULL) {
+            ESP_LOGE(tp->cfg->tag, "HTTP Client Initialization Failed");
+            return NULL;
+        }
+        esp_http_client_set_header(tp->client, "Content-Type",
+                                   tp->cbor ? TELEMETRY_CBOR_CONTENT_TYPE : "application/json");
+    }
+    return tp->client;
+}
+
+// One POST on the telemetry client; *reused tells whether it went out on
+// an already open connection
+static inline esp_err_t telemetry_push_post(telemetry_push_t *tp, const char *body, int len, bool *reused)
+{
+    esp_http_client_handle_t client = telemetry_push_client(tp);
+    if (client == NULL) {
+        *reused = false;
+        return ESP_ERR_NO_MEM;
+    }
+    *reused = tp->conn_open;
+    esp_http_client_set_post_field(client, body, len);
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK) {
+        // Drop the socket; the next perform opens a fresh connection
+        esp_http_client_close(client);
+        tp->conn_open = false;
+    }
+    return err;
+}
+
+// POST one body, with one retry when the server dropped the kept-alive
+// connection meanwhile
+static inline esp_err_t telemetry_push_body(telemetry_push_t *tp, const char *body, int len)
+{
+    const char *tag = tp->cfg->tag;
+
+    // Once the server's idle timeout is known (see push_idle_t), past it
+    // reconnect up front instead
+    int64_t start = esp_timer_get_time();
+    int64_t idle_us = start - tp->last_us;
+    if (tp->conn_open && push_idle_reconnect(&tp->idle, idle_us)) {
+        esp_http_client_close(tp->client);
+        tp->conn_open = false;
+    }
+    bool reused;
+    esp_err_t err = telemetry_push_post(tp, body, len, &reused);
+    if (reused) {
+        push_idle_note(&tp->idle, err == ESP_OK, idle_us);
+    }
+    if (err != ESP_OK && reused) {
+        ESP_LOGW(tag, "Kept-alive connection lost (%s), reconnecting", esp_err_to_name(err));
+        tp->stats.retries++;
+        start = esp_timer_get_time();
+        err = telemetry_push_post(tp, body, len, &reused);
+    }
+    tp->last_us = esp_timer_get_time();
+    int64_t took_us = tp->last_us - start;
+    push_stats_note(&tp->stats, err == ESP_OK, reused, took_us);
+
+    if (err == ESP_OK) {
+        int status_code = esp_http_client_get_status_code(tp->client);
+        ESP_LOGI(tag, "Data Push Done - HTTP Status=%d, %lld ms on %s connection",
+                 status_code, (long long)(took_us / 1000), reused ? "kept-alive" : "new");
+        ESP_LOGI(tag, "Push connections: %lu new / %lu reused, ~%lld ms saved per reused push, "
+                 "%lld ms in total", (unsigned long)tp->stats.connects,
+                 (unsigned long)tp->stats.reused,
+                 (long long)(push_stats_saved_per_push_us(&tp->stats) / 1000),
+                 (long long)(push_stats_saved_us(&tp->stats) / 1000));
+    } else {
+        ESP_LOGE(tag, "Data Push Failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// Encode a batch in the negotiated format and POST it. ESP_OK once the
+// server answered 2xx; any other answer keeps the batch for the next
+// push, except one saying the batch itself is bad, which would block
+// everything behind it and is dropped.
+static inline esp_err_t telemetry_push_send(telemetry_push_t *tp, const telemetry_record_t *rec, uint32_t n)
+{
+    const char *tag = tp->cfg->tag;
+    size_t len;
+    if (tp->cbor) {
+        uint8_t color[4];
+        bool has_color = tp->cfg->batch_color != NULL;
+        if (has_color) {
+            tp->cfg->batch_color(color);
+        }
+        len = telemetry_cbor_batch((uint8_t *)tp->body, sizeof(tp->body), tp->cfg->device_id,
+                                   rec, n, has_color ? color : NULL);
+    } else {
+        len = tp->cfg->batch_json(tp->body, sizeof(tp->body), rec, n);
+    }
+    if (len == 0) {
+        // Cannot happen with the buffer sized for the worst case
+        ESP_LOGE(tag, "Telemetry batch exceeds %d bytes, dropped", TELEMETRY_BATCH_JSON_MAX);
+        return ESP_OK;
+    }
+
+    esp_err_t err = telemetry_push_body(tp, tp->body, (int)len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    int status = esp_http_client_get_status_code(tp->client);
+    if (status == 415 && tp->cbor) {
+        ESP_LOGW(tag, "Server does not accept %s, falling back to JSON", TELEMETRY_CBOR_CONTENT_TYPE);
+        tp->cbor = false;
+        esp_http_client_set_header(tp->client, "Content-Type", "application/json");
+        return telemetry_push_send(tp, rec, n);
+    }
+    if (status >= 200 && status < 300) {
+        return ESP_OK;
+    }
+    if (status == 400 || status == 413 || status == 422) {
+        tp->refused += n;
+        ESP_LOGE(tag, "Server refused a batch of %lu records (HTTP %d), dropped",
+                 (unsigned long)n, status);
+        return ESP_OK;
+    }
+    ESP_LOGW(tag, "Server answered HTTP %d, batch kept for the next push", status);
+    return ESP_FAIL;
+}
+
+// ==================== Spool ====================
+
+static inline bool telemetry_push_flash_read(void *ctx, uint32_t offset, void *dst, uint32_t len)
+{
+    return esp_partition_read(ctx, offset, dst, len) == ESP_OK;
+}
+
+static inline bool telemetry_push_flash_write(void *ctx, uint32_t offset, const void *src, uint32_t len)
+{
+    return esp_partition_write(ctx, offset, src, len) == ESP_OK;
+}
+
+static inline bool telemetry_push_flash_erase(void *ctx, uint32_t offset, uint32_t len)
+{
+    return esp_partition_erase_range(ctx, offset, len) == ESP_OK;
+}
+
+// Bind the configuration and mount the spool partition; call from the
+// uploader task before the first push
+static inline void telemetry_push_init(telemetry_push_t *tp, const telemetry_push_config_t *cfg)
+{
+    *tp = (telemetry_push_t){ .cfg = cfg, .idle = PUSH_IDLE_INIT, .cbor = cfg->cbor };
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           cfg->spool_label);
+    if (part == NULL) {
+        ESP_LOGW(cfg->tag, "No \"%s\" partition, unsent telemetry is kept in RAM only",
+                 cfg->spool_label);
+        return;
+    }
+    const telemetry_spool_flash_t flash = {
+        .ctx = (void *)part,
+        .read = telemetry_push_flash_read,
+        .write = telemetry_push_flash_write,
+        .erase = telemetry_push_flash_erase,
+    };
+    tp->spool_ready = telemetry_spool_mount(&tp->spool, &flash, part->size);
+    if (!tp->spool_ready) {
+        ESP_LOGE(cfg->tag, "Spool partition unreadable, unsent telemetry is kept in RAM only");
+        return;
+    }
+    ESP_LOGI(cfg->tag, "Spool: %lu KB, %lu records waiting, most worn sector erased %lu times",
+             (unsigned long)(part->size / 1024), (unsigned long)tp->spool.count,
+             (unsigned long)tp->spool.max_erases);
+}
+
+// Move everything in the RAM ring to flash
+static inline void telemetry_push_spool_ring(telemetry_push_t *tp)
+{
+    telemetry_ring_t *ring = tp->cfg->ring;
+    portMUX_TYPE *mux = tp->cfg->ring_mux;
+
+    while (tp->spool_ready) {
+        uint32_t first;
+        taskENTER_CRITICAL(mux);
+        uint32_t n = telemetry_ring_peek(ring, tp->batch, TELEMETRY_BATCH_MAX, &first);
+        taskEXIT_CRITICAL(mux);
+        if (n == 0) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (!telemetry_spool_append(&tp->spool, &tp->batch[i])) {
+                ESP_LOGE(tp->cfg->tag, "Spool write failed, unsent telemetry is kept in RAM only");
+                tp->spool_ready = false;
+                n = i;
+                break;
+            }
+        }
+
+        taskENTER_CRITICAL(mux);
+        telemetry_ring_commit(ring, first, n);
+        taskEXIT_CRITICAL(mux);
+    }
+}
+
+// Send spooled records, oldest first, rate limited. A batch leaves the
+// flash only once the server took it (see telemetry_push_send), so a
+// server answering 5xx for hours loses nothing. True once the spool is
+// empty.
+static inline bool telemetry_push_spool_drain(telemetry_push_t *tp)
+{
+    for (int i = 0; tp->spool_ready && tp->spool.count > 0; i++) {
+        if (i == tp->cfg->drain_batches) {
+            return false;
+        }
+        if (i > 0 && tp->cfg->drain_gap_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(tp->cfg->drain_gap_ms));
+        }
+
+        uint32_t end;
+        uint32_t n = telemetry_spool_peek(&tp->spool, tp->batch, TELEMETRY_BATCH_MAX, &end);
+        if (n == 0) {
+            break;
+        }
+        if (telemetry_push_send(tp, tp->batch, n) != ESP_OK) {
+            return false;
+        }
+        telemetry_spool_commit(&tp->spool, end);
+    }
+    return true;
+}
+
+// Send what the RAM ring held when called. A batch is only removed once
+// telemetry_push_send() says it is done with it. True if everything went
+// out.
+static inline bool telemetry_push_ring_drain(telemetry_push_t *tp)
+{
+    telemetry_ring_t *ring = tp->cfg->ring;
+    portMUX_TYPE *mux = tp->cfg->ring_mux;
+
+    taskENTER_CRITICAL(mux);
+    uint32_t pending = telemetry_ring_count(ring);
+    taskEXIT_CRITICAL(mux);
+
+    while (pending > 0) {
+        uint32_t first;
+        taskENTER_CRITICAL(mux);
+        uint32_t n = telemetry_ring_peek(ring, tp->batch, TELEMETRY_BATCH_MAX, &first);
+        taskEXIT_CRITICAL(mux);
+        if (n == 0) {
+            break;
+        }
+
+        if (telemetry_push_send(tp, tp->batch, n) != ESP_OK) {
+            return false;
+        }
+
+        taskENTER_CRITICAL(mux);
+        telemetry_ring_commit(ring, first, n);
+        taskEXIT_CRITICAL(mux);
+        pending = (n < pending) ? pending - n : 0;
+    }
+    return true;
+}
+
+// ==================== Push ====================
+
+// One push: spooled records are older than anything in the ring, so they
+// go first; until the spool is empty, or whenever the server cannot be
+// reached, the ring is moved to flash instead of sent
+static inline void telemetry_push_run(telemetry_push_t *tp, bool online)
+{
+    taskENTER_CRITICAL(tp->cfg->ring_mux);
+    uint32_t pending = telemetry_ring_count(tp->cfg->ring);
+    uint32_t dropped = tp->cfg->ring->dropped;
+    taskEXIT_CRITICAL(tp->cfg->ring_mux);
+    ESP_LOGI(tp->cfg->tag, "Pushing %lu telemetry records, %lu spooled (%lu dropped so far)%s",
+             (unsigned long)pending, (unsigned long)(tp->spool_ready ? tp->spool.count : 0),
+             (unsigned long)(dropped + tp->refused + tp->spool.dropped),
+             online ? "" : ", WiFi down");
+
+    if (!online || !telemetry_push_spool_drain(tp) || !telemetry_push_ring_drain(tp)) {
+        telemetry_push_spool_ring(tp);
+    }
+}
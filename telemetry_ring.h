@@ -0,0 +1,100 @@
+/*
+ * Telemetry Ring - Timestamped Samples and Events Awaiting Upload
+ *
+ * Shared by the firmware variants that push telemetry. Producers append
+ * fixed-size records (periodic samples, PIR edges, light and mode
+ * switches); the push drains them in batches: peek a run of records,
+ * POST them, and commit only once the server has accepted them. When the
+ * ring is full the oldest record is overwritten and counted as dropped,
+ * so a long outage loses the start of the gap, never the latest state.
+ *
+ * Not locked: producers and the drain must be serialized by the caller
+ * (a short critical section around put/peek/commit).
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef TELEMETRY_RING_SIZE
+#define TELEMETRY_RING_SIZE     256     // Records; must be a power of two
+#endif
+#define TELEMETRY_RING_MASK     (TELEMETRY_RING_SIZE - 1)
+
+typedef enum {
+    TELEMETRY_SAMPLE = 0,       // Periodic sensor reading
+    TELEMETRY_MOTION,           // PIR edge
+    TELEMETRY_LIGHT,            // Light switched on or off
+    TELEMETRY_MODE,             // Auto/manual mode switched
+} telemetry_kind_t;
+
+// Every record carries the full state, so each one stands on its own
+typedef struct {
+    int64_t t_ms;               // Wall clock (gettimeofday) in ms
+    uint16_t light_value;
+    uint16_t light_mv;
+    uint16_t light_lux;
+    uint8_t light_percent;
+    uint8_t kind;               // telemetry_kind_t
+    bool motion;
+    bool light_on;
+    bool auto_mode;
+} telemetry_record_t;
+
+typedef struct {
+    telemetry_record_t rec[TELEMETRY_RING_SIZE];
+    uint32_t head;              // Records ever put
+    uint32_t tail;              // Oldest record not yet uploaded
+    uint32_t dropped;           // Overwritten before they were uploaded
+} telemetry_ring_t;
+
+static inline const char *telemetry_kind_name(telemetry_kind_t kind)
+{
+    switch (kind) {
+        case TELEMETRY_MOTION: return "motion";
+        case TELEMETRY_LIGHT:  return "light";
+        case TELEMETRY_MODE:   return "mode";
+        default:               return "sample";
+    }
+}
+
+static inline uint32_t telemetry_ring_count(const telemetry_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+static inline void telemetry_ring_put(telemetry_ring_t *ring, const telemetry_record_t *rec)
+{
+    if (telemetry_ring_count(ring) == TELEMETRY_RING_SIZE) {
+        ring->tail++;
+        ring->dropped++;
+    }
+    ring->rec[ring->head & TELEMETRY_RING_MASK] = *rec;
+    ring->head++;
+}
+
+// Copy up to max of the oldest records into out without removing them;
+// *first identifies the run for telemetry_ring_commit()
+static inline uint32_t telemetry_ring_peek(const telemetry_ring_t *ring, telemetry_record_t *out,
+                                           uint32_t max, uint32_t *first)
+{
+    uint32_t n = telemetry_ring_count(ring);
+    if (n > max) {
+        n = max;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = ring->rec[(ring->tail + i) & TELEMETRY_RING_MASK];
+    }
+    *first = ring->tail;
+    return n;
+}
+
+// Remove a peeked run once uploaded. Records overwritten meanwhile have
+// already moved the tail past some or all of it.
+static inline void telemetry_ring_commit(telemetry_ring_t *ring, uint32_t first, uint32_t n)
+{
+    uint32_t end = first + n;
+    if ((int32_t)(end - ring->tail) > 0) {
+        ring->tail = end;
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * Telemetry Spool - Store-and-Forward Log in a Flash Partition
+ *
+ * Shared by the firmware variants that push telemetry. While the server
+ * cannot be reached, records drained from the RAM ring (telemetry_ring.h)
+ * are appended here instead of being lost, and are uploaded oldest first
+ * once it can be reached again. The log survives reboots.
+ *
+ * Layout: the partition is a ring of 4 KB flash sectors, each with a
+ * small header (magic, sequence number, erase count) followed by
+ * fixed-size entries. Sectors are filled and erased strictly in turn, so
+ * every sector sees the same number of erases; the count is kept in the
+ * header across erases. Entry states only ever clear bits (NOR flash can
+ * program 1 -> 0 without an erase):
+ *
+ *   EMPTY     0xFFFFFFFF  erased, free
+ *   RESERVED  0x00FFFFFF  write started; stays so if power failed midway
+ *   VALID     0x0000FFFF  record complete, not yet uploaded
+ *   SENT      0x00000000  uploaded
+ *
+ * so uploading a record costs one 4-byte write, and sectors are only
+ * erased when the head comes round to reuse them. If the log is full the
+ * oldest sector is reused and its unsent records are counted as dropped.
+ *
+ * Flash access goes through the three callbacks (esp_partition_read/
+ * write/erase_range on the board). Not locked: one task owns the spool.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "telemetry_ring.h"
+
+#define TELEMETRY_SPOOL_SECTOR      4096
+#define TELEMETRY_SPOOL_MAGIC       0x31505354      // "TSP1"
+
+#define TELEMETRY_SPOOL_EMPTY       0xFFFFFFFFu
+#define TELEMETRY_SPOOL_RESERVED    0x00FFFFFFu
+#define TELEMETRY_SPOOL_VALID       0x0000FFFFu
+#define TELEMETRY_SPOOL_SENT        0x00000000u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // Increases with every sector opened
+    uint32_t erases;            // Times this sector has been erased
+    uint32_t reserved;
+} telemetry_spool_header_t;
+
+typedef struct {
+    uint32_t state;
+    uint32_t reserved;
+    telemetry_record_t rec;
+} telemetry_spool_entry_t;
+
+#define TELEMETRY_SPOOL_PER_SECTOR \
+    ((TELEMETRY_SPOOL_SECTOR - sizeof(telemetry_spool_header_t)) / sizeof(telemetry_spool_entry_t))
+
+typedef struct {
+    void *ctx;
+    bool (*read)(void *ctx, uint32_t offset, void *dst, uint32_t len);
+    bool (*write)(void *ctx, uint32_t offset, const void *src, uint32_t len);
+    bool (*erase)(void *ctx, uint32_t offset, uint32_t len);
+} telemetry_spool_flash_t;
+
+typedef struct {
+    telemetry_spool_flash_t flash;
+    uint32_t sectors;
+    uint32_t slots;             // sectors * TELEMETRY_SPOOL_PER_SECTOR
+    uint32_t head;              // Next slot to write
+    uint32_t tail;              // Oldest slot that may hold an unsent record
+    uint32_t seq;               // Sequence number of the newest sector
+    uint32_t count;             // Unsent records
+    uint32_t dropped;           // Unsent records lost to a full log
+    uint32_t max_erases;        // Most erases of any sector
+    bool failed;                // Flash error; the spool stays out of use
+} telemetry_spool_t;
+
+static inline uint32_t telemetry_spool_offset(uint32_t slot)
+{
+    uint32_t sector = slot / TELEMETRY_SPOOL_PER_SECTOR;
+    uint32_t index = slot % TELEMETRY_SPOOL_PER_SECTOR;
+    return sector * TELEMETRY_SPOOL_SECTOR + sizeof(telemetry_spool_header_t)
+           + index * sizeof(telemetry_spool_entry_t);
+}
+
+static inline uint32_t telemetry_spool_next(const telemetry_spool_t *sp, uint32_t slot)
+{
+    return (slot + 1 == sp->slots) ? 0 : slot + 1;
+}
+
+static inline uint32_t telemetry_spool_state(telemetry_spool_t *sp, uint32_t slot)
+{
+    uint32_t state = TELEMETRY_SPOOL_SENT;
+    if (!sp->flash.read(sp->flash.ctx, telemetry_spool_offset(slot), &state, sizeof(state))) {
+        sp->failed = true;
+    }
+    return state;
+}
+
+static inline bool telemetry_spool_set_state(telemetry_spool_t *sp, uint32_t slot, uint32_t state)
+{
+    if (!sp->flash.write(sp->flash.ctx, telemetry_spool_offset(slot), &state, sizeof(state))) {
+        sp->failed = true;
+    }
+    return !sp->failed;
+}
+
+static inline bool telemetry_spool_read_header(telemetry_spool_t *sp, uint32_t sector,
+                                               telemetry_spool_header_t *hdr)
+{
+    if (!sp->flash.read(sp->flash.ctx, sector * TELEMETRY_SPOOL_SECTOR, hdr, sizeof(*hdr))) {
+        sp->failed = true;
+        return false;
+    }
+    return hdr->magic == TELEMETRY_SPOOL_MAGIC;
+}
+
+// Find the newest sector and the first free slot in it, then walk from
+// the oldest sector to the head counting records not yet uploaded
+static inline bool telemetry_spool_mount(telemetry_spool_t *sp, const telemetry_spool_flash_t *flash,
+                                         uint32_t size)
+{
+    *sp = (telemetry_spool_t){
+        .flash = *flash,
+        .sectors = size / TELEMETRY_SPOOL_SECTOR,
+    };
+    sp->slots = sp->sectors * TELEMETRY_SPOOL_PER_SECTOR;
+    if (sp->sectors < 2) {
+        sp->failed = true;
+        return false;
+    }
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t s = 0; s < sp->sectors; s++) {
+        telemetry_spool_header_t hdr;
+        if (!telemetry_spool_read_header(sp, s, &hdr)) {
+            continue;
+        }
+        if (hdr.erases > sp->max_erases) {
+            sp->max_erases = hdr.erases;
+        }
+        if (!found || (int32_t)(hdr.seq - sp->seq) > 0) {
+            found = true;
+            newest = s;
+            sp->seq = hdr.seq;
+        }
+    }
+    if (sp->failed) {
+        return false;
+    }
+    if (!found) {
+        // Blank partition: the first append opens sector 0
+        return true;
+    }
+
+    uint32_t slot = newest * TELEMETRY_SPOOL_PER_SECTOR;
+    uint32_t end = slot + TELEMETRY_SPOOL_PER_SECTOR;
+    while (slot < end && telemetry_spool_state(sp, slot) != TELEMETRY_SPOOL_EMPTY) {
+        slot++;
+    }
+    sp->head = (slot == sp->slots) ? 0 : slot;
+
+    // The sector after the head sector is the oldest one
+    uint32_t first = (newest + 1) % sp->sectors;
+    sp->tail = sp->head;
+    for (uint32_t i = 0; i < sp->sectors; i++) {
+        uint32_t s = (first + i) % sp->sectors;
+        telemetry_spool_header_t hdr;
+        if (!telemetry_spool_read_header(sp, s, &hdr)) {
+            continue;
+        }
+        uint32_t from = s * TELEMETRY_SPOOL_PER_SECTOR;
+        uint32_t to = (s == newest) ? slot : from + TELEMETRY_SPOOL_PER_SECTOR;
+        for (uint32_t k = from; k < to; k++) {
+            if (telemetry_spool_state(sp, k) == TELEMETRY_SPOOL_VALID) {
+                if (sp->count == 0) {
+                    sp->tail = k;
+                }
+                sp->count++;
+            }
+        }
+    }
+    return !sp->failed;
+}
+
+// Erase the sector the head has reached and stamp a fresh header. If the
+// tail is still in it (log full), its unsent records are given up.
+static inline bool telemetry_spool_open_sector(telemetry_spool_t *sp)
+{
+    uint32_t sector = sp->head / TELEMETRY_SPOOL_PER_SECTOR;
+    if (sp->count > 0 && sp->tail / TELEMETRY_SPOOL_PER_SECTOR == sector) {
+        uint32_t end = (sector + 1) * TELEMETRY_SPOOL_PER_SECTOR;
+        for (uint32_t k = sp->tail; k < end; k++) {
+            if (telemetry_spool_state(sp, k) == TELEMETRY_SPOOL_VALID) {
+                sp->count--;
+                sp->dropped++;
+            }
+        }
+        sp->tail = (end == sp->slots) ? 0 : end;
+    }
+
+    telemetry_spool_header_t hdr;
+    uint32_t erases = telemetry_spool_read_header(sp, sector, &hdr) ? hdr.erases : 0;
+    hdr = (telemetry_spool_header_t){
+        .magic = TELEMETRY_SPOOL_MAGIC,
+        .seq = sp->seq + 1,
+        .erases = erases + 1,
+        .reserved = TELEMETRY_SPOOL_EMPTY,
+    };
+    if (!sp->flash.erase(sp->flash.ctx, sector * TELEMETRY_SPOOL_SECTOR, TELEMETRY_SPOOL_SECTOR) ||
+        !sp->flash.write(sp->flash.ctx, sector * TELEMETRY_SPOOL_SECTOR, &hdr, sizeof(hdr))) {
+        sp->failed = true;
+        return false;
+    }
+    sp->seq = hdr.seq;
+    if (hdr.erases > sp->max_erases) {
+        sp->max_erases = hdr.erases;
+    }
+    if (sp->count == 0) {
+        sp->tail = sp->head;
+    }
+    return true;
+}
+
+static inline bool telemetry_spool_append(telemetry_spool_t *sp, const telemetry_record_t *rec)
+{
+    if (sp->failed) {
+        return false;
+    }
+    if (sp->head % TELEMETRY_SPOOL_PER_SECTOR == 0 && !telemetry_spool_open_sector(sp)) {
+        return false;
+    }
+    uint32_t offset = telemetry_spool_offset(sp->head);
+    telemetry_spool_entry_t entry = {
+        .state = TELEMETRY_SPOOL_RESERVED,
+        .reserved = TELEMETRY_SPOOL_EMPTY,
+        .rec = *rec,
+    };
+    if (!telemetry_spool_set_state(sp, sp->head, TELEMETRY_SPOOL_RESERVED) ||
+        !sp->flash.write(sp->flash.ctx, offset + sizeof(uint32_t),
+                         (const uint8_t *)&entry + sizeof(uint32_t), sizeof(entry) - sizeof(uint32_t)) ||
+        !telemetry_spool_set_state(sp, sp->head, TELEMETRY_SPOOL_VALID)) {
+        sp->failed = true;
+        return false;
+    }
+    if (sp->count == 0) {
+        sp->tail = sp->head;
+    }
+    sp->count++;
+    sp->head = telemetry_spool_next(sp, sp->head);
+    return true;
+}
+
+// Read up to max of the oldest unsent records; *end marks the run for
+// telemetry_spool_commit()
+static inline uint32_t telemetry_spool_peek(telemetry_spool_t *sp, telemetry_record_t *out,
+                                            uint32_t max, uint32_t *end)
+{
+    uint32_t n = 0;
+    uint32_t slot = sp->tail;
+    while (n < max && n < sp->count && slot != sp->head && !sp->failed) {
+        telemetry_spool_entry_t entry;
+        if (!sp->flash.read(sp->flash.ctx, telemetry_spool_offset(slot), &entry, sizeof(entry))) {
+            sp->failed = true;
+            break;
+        }
+        if (entry.state == TELEMETRY_SPOOL_VALID) {
+            out[n++] = entry.rec;
+        }
+        slot = telemetry_spool_next(sp, slot);
+    }
+    *end = slot;
+    return n;
+}
+
+// Mark a peeked run uploaded
+static inline void telemetry_spool_commit(telemetry_spool_t *sp, uint32_t end)
+{
+    while (sp->tail != end && sp->count > 0 && !sp->failed) {
+        if (telemetry_spool_state(sp, sp->tail) == TELEMETRY_SPOOL_VALID &&
+            telemetry_spool_set_state(sp, sp->tail, TELEMETRY_SPOOL_SENT)) {
+            sp->count--;
+        }
+        sp->tail = telemetry_spool_next(sp, sp->tail);
+    }
+    if (sp->count == 0) {
+        sp->tail = sp->head;
+    }
+}
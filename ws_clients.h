@@ -0,0 +1,92 @@
+/*
+ * WebSocket Clients - Subscriber Table for the Status Push
+ *
+ * Shared by the firmware variants that push /status changes over /ws. A
+ * client is added once its handshake is done and owes the full status
+ * ("fresh") until the next push; after that it only gets the frames of
+ * fields that changed. A client whose socket is no longer a WebSocket, or
+ * whose send fails, is dropped.
+ *
+ * Not locked: only the HTTP server task touches the table (handlers and
+ * httpd_queue_work). The count may be read from any task to decide
+ * whether a push is worth scheduling at all.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+
+#define WS_CLIENTS_MAX  4
+
+typedef struct {
+    int fd;
+    bool used;
+    bool fresh;             // Connected since the last push: owed the full status
+} ws_client_t;
+
+typedef struct {
+    const char *tag;        // Log tag of the firmware
+    ws_client_t slot[WS_CLIENTS_MAX];
+    volatile int count;
+} ws_clients_t;
+
+static inline bool ws_clients_add(ws_clients_t *c, int fd)
+{
+    for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+        if (!c->slot[i].used) {
+            c->slot[i] = (ws_client_t){ .fd = fd, .used = true, .fresh = true };
+            c->count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void ws_clients_drop(ws_clients_t *c, ws_client_t *client)
+{
+    ESP_LOGI(c->tag, "Status push: client %d gone", client->fd);
+    client->used = false;
+    c->count--;
+}
+
+static inline bool ws_clients_send_text(httpd_handle_t server, int fd, const char *buf, size_t len)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)buf,
+        .len = len,
+    };
+    return httpd_ws_send_frame_async(server, fd, &frame) == ESP_OK;
+}
+
+// One push: fresh clients get full, the others delta if changed. Call
+// from the server task, which owns the sockets.
+static inline void ws_clients_push(ws_clients_t *c, httpd_handle_t server,
+                                   const char *full, size_t full_len,
+                                   const char *delta, size_t delta_len, bool changed)
+{
+    for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+        ws_client_t *client = &c->slot[i];
+        if (!client->used) {
+            continue;
+        }
+        if (httpd_ws_get_fd_info(server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_clients_drop(c, client);
+            continue;
+        }
+        bool sent = true;
+        if (client->fresh) {
+            sent = ws_clients_send_text(server, client->fd, full, full_len);
+            client->fresh = false;
+        } else if (changed) {
+            sent = ws_clients_send_text(server, client->fd, delta, delta_len);
+        }
+        if (!sent) {
+            ws_clients_drop(c, client);
+        }
+    }
+}